@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// runs every workload in bench/ on each engine and prints the results as
+// JSON: the best and median wall time, statements per second at the best
+// time and the peak RSS. statements are counted once per workload with
+// --profile, each program line holds one. workloads are copied to the
+// current directory first, since --profile and --compile write next to
+// the program.
+//
+//   basic_bench [--runs n] [--output file] <basic executable> <bench dir>
+
+#define DEFAULT_RUNS 5
+#define MAX_RUNS 100
+
+static const char *workloads[] = {"sieve", "fibonacci", "kernels", "strings", "state_machine", "report"};
+
+typedef struct engine_t {
+    const char *name;
+    const char *option; // NULL for none
+    int image; // runs the compiled program image instead of the source
+} Engine;
+
+static const Engine engines[] = {
+    {"tree", NULL, 0},
+    {"vm", "--vm", 0},
+    {"image", NULL, 1},
+};
+
+typedef struct run_t {
+    double seconds;
+    long peak_rss_kb;
+} Run;
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// runs basic with up to two arguments, output discarded; 0 when it fails
+static int run_basic(const char *basic, const char *option, const char *program, Run *run) {
+    const double started = now_seconds();
+    const pid_t pid = fork();
+    if (pid < 0) return 0;
+
+    if (pid == 0) {
+        const int null = open("/dev/null", O_RDWR);
+        if (null >= 0) {
+            dup2(null, STDIN_FILENO);
+            dup2(null, STDOUT_FILENO);
+        }
+        if (option) {
+            execl(basic, basic, option, program, (char *)NULL);
+        } else {
+            execl(basic, basic, program, (char *)NULL);
+        }
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) return 0;
+    run->seconds = now_seconds() - started;
+#ifdef __APPLE__
+    run->peak_rss_kb = usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    run->peak_rss_kb = usage.ru_maxrss;
+#endif
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int copy_file(const char *from, const char *to) {
+    FILE *in = fopen(from, "rb");
+    if (!in) return 0;
+    FILE *out = fopen(to, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+
+    char buffer[65536];
+    size_t count;
+    int ok = 1;
+    while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, count, out) != count) ok = 0;
+    }
+    fclose(in);
+    if (fclose(out) != 0) ok = 0;
+    return ok;
+}
+
+// lines executed by one run, read from the first line of the --profile report
+static long long count_statements(const char *basic, const char *program) {
+    Run run;
+    if (!run_basic(basic, "--profile", program, &run)) return -1;
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s.prof", program);
+    FILE *report = fopen(path, "r");
+    long long statements = -1;
+    if (report) {
+        if (fscanf(report, "Profile: %lld lines executed", &statements) != 1) statements = -1;
+        fclose(report);
+    }
+    remove(path);
+    snprintf(path, sizeof(path), "%s.folded", program);
+    remove(path);
+    return statements;
+}
+
+static int compare_runs(const void *a, const void *b) {
+    const double left = ((const Run *)a)->seconds;
+    const double right = ((const Run *)b)->seconds;
+    return (left > right) - (left < right);
+}
+
+static void print_usage(void) {
+    fprintf(stderr, "usage: basic_bench [--runs n] [--output file] <basic executable> <bench dir>\n");
+}
+
+int main(int argc, char **argv) {
+    int runs = DEFAULT_RUNS;
+    const char *output_path = NULL;
+    const char *basic = NULL;
+    const char *directory = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (argv[i][0] == '-' || directory) {
+            print_usage();
+            return 1;
+        } else if (!basic) {
+            basic = argv[i];
+        } else {
+            directory = argv[i];
+        }
+    }
+    if (!directory || runs < 1 || runs > MAX_RUNS) {
+        print_usage();
+        return 1;
+    }
+
+    FILE *out = output_path ? fopen(output_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Cannot write %s\n", output_path);
+        return 1;
+    }
+
+    const int workload_count = (int)(sizeof(workloads) / sizeof(workloads[0]));
+    const int engine_count = (int)(sizeof(engines) / sizeof(engines[0]));
+    int failed = 0;
+    int first = 1;
+    fprintf(out, "{\n  \"runs\": %d,\n  \"results\": [", runs);
+
+    for (int w = 0; w < workload_count; w++) {
+        char source[1024];
+        char program[256];
+        char image[256];
+        snprintf(source, sizeof(source), "%s/%s.bas", directory, workloads[w]);
+        snprintf(program, sizeof(program), "%s.bas", workloads[w]);
+        snprintf(image, sizeof(image), "%s.basc", workloads[w]);
+
+        Run run;
+        long long statements = -1;
+        if (!copy_file(source, program)) {
+            fprintf(stderr, "%s: cannot copy %s\n", workloads[w], source);
+        } else if ((statements = count_statements(basic, program)) < 0) {
+            fprintf(stderr, "%s: the profiled run failed\n", workloads[w]);
+        } else if (!run_basic(basic, "--compile", program, &run)) {
+            fprintf(stderr, "%s: cannot compile a program image\n", workloads[w]);
+            statements = -1;
+        }
+        if (statements < 0) {
+            failed = 1;
+            remove(program);
+            continue;
+        }
+
+        for (int e = 0; e < engine_count; e++) {
+            const Engine *engine = &engines[e];
+            Run results[MAX_RUNS];
+            long peak_rss_kb = 0;
+            int ok = 1;
+            for (int r = 0; r < runs && ok; r++) {
+                ok = run_basic(basic, engine->option, engine->image ? image : program, &results[r]);
+                if (results[r].peak_rss_kb > peak_rss_kb) peak_rss_kb = results[r].peak_rss_kb;
+            }
+            if (!ok) {
+                fprintf(stderr, "%s on %s: the program failed\n", workloads[w], engine->name);
+                failed = 1;
+                continue;
+            }
+
+            qsort(results, (size_t)runs, sizeof(Run), compare_runs);
+            const double best = results[0].seconds;
+            const double median = runs % 2 ? results[runs / 2].seconds
+                                           : (results[runs / 2 - 1].seconds + results[runs / 2].seconds) / 2;
+            fprintf(stderr, "%-14s %-6s %8.3f s %14.0f statements/s %8ld KB\n", workloads[w], engine->name, best,
+                    (double)statements / best, peak_rss_kb);
+            fprintf(out, "%s\n    {\"workload\": \"%s\", \"engine\": \"%s\", \"statements\": %lld, "
+                         "\"best_seconds\": %.6f, \"median_seconds\": %.6f, \"statements_per_second\": %.0f, "
+                         "\"peak_rss_kb\": %ld}",
+                    first ? "" : ",", workloads[w], engine->name, statements, best, median,
+                    (double)statements / best, peak_rss_kb);
+            first = 0;
+        }
+        remove(program);
+        remove(image);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return failed;
+}
@@ -0,0 +1,26 @@
+10 REM fibonacci by recursive GOSUB, arguments and results on explicit stacks
+20 DIM N(64), A(64)
+30 S = 0
+40 P = 0
+50 FOR K = 1 TO 25
+60 P = P + 1
+70 N(P) = K
+80 GOSUB 1000
+90 S = S + R
+100 P = P - 1
+110 NEXT K
+120 PRINT "sum of fib(1..25): "; S; "\n"
+130 END
+1000 REM R = fib(N(P))
+1010 IF N(P) < 2 THEN GOTO 1100
+1020 P = P + 1
+1030 N(P) = N(P - 1) - 1
+1040 GOSUB 1000
+1050 A(P - 1) = R
+1060 N(P) = N(P - 1) - 2
+1070 GOSUB 1000
+1080 R = R + A(P - 1)
+1090 P = P - 1
+1095 RETURN
+1100 R = N(P)
+1110 RETURN
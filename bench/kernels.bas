@@ -0,0 +1,32 @@
+10 REM nested FOR kernels: a matrix product, a dot product and a polynomial
+20 N = 80
+30 DIM A(80, 80), B(80, 80), C(80, 80)
+40 FOR I = 1 TO N
+50 FOR J = 1 TO N
+60 A(I, J) = (I + J) / N
+70 B(I, J) = (I * J) / N
+80 NEXT J
+90 NEXT I
+100 FOR I = 1 TO N
+110 FOR J = 1 TO N
+120 T = 0
+130 FOR K = 1 TO N
+140 T = T + A(I, K) * B(K, J)
+150 NEXT K
+160 C(I, J) = T
+170 NEXT J
+180 NEXT I
+190 D = 0
+200 FOR R = 1 TO 100
+210 FOR I = 1 TO N
+220 FOR J = 1 TO N
+230 D = D + C(I, J) * A(J, I)
+240 NEXT J
+250 NEXT I
+260 NEXT R
+270 P = 0
+280 FOR X = 0 TO 1 STEP 0.000002
+290 P = P + ((3 * X - 2) * X + 1) * X - 5
+300 NEXT X
+310 PRINT "trace "; D; " polynomial "; P; "\n"
+320 END
@@ -0,0 +1,69 @@
+#include "tokenizer/keywords.c"
+#include <time.h>
+
+// the perfect-hash keyword lookup against the linear strcasecmp scan it
+// replaced, over a mix of keywords and variable names as they come out of
+// typical programs. the generated source is included to reach its table,
+// so both lookups search exactly the same keywords. prints JSON.
+//
+//   keyword_bench [rounds]
+
+#define DEFAULT_ROUNDS 1000000
+
+static const char *identifiers[] = {
+    "PRINT", "X", "FOR", "I", "TO", "NEXT", "GOSUB", "TOTAL", "IF", "THEN",
+    "A$", "LEN", "COUNT%", "GOTO", "RETURN", "N", "STEP", "CHR$", "LET", "ROW",
+};
+
+static double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+// how the tokenizer classified identifiers before the table was generated
+static const Keyword *scan_keywords(const char *text) {
+    for (int i = 0; i < KEYWORD_SLOTS; i++) {
+        if (keyword_slots[i].name && strcasecmp(text, keyword_slots[i].name) == 0) return &keyword_slots[i];
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    const long rounds = argc > 1 ? atol(argv[1]) : DEFAULT_ROUNDS;
+    if (rounds < 1) {
+        fprintf(stderr, "usage: keyword_bench [rounds]\n");
+        return 1;
+    }
+
+    const int count = (int)(sizeof(identifiers) / sizeof(identifiers[0]));
+    size_t lengths[sizeof(identifiers) / sizeof(identifiers[0])];
+    for (int i = 0; i < count; i++) {
+        lengths[i] = strlen(identifiers[i]);
+        // both lookups have to agree before their times mean anything
+        if (find_keyword(identifiers[i], lengths[i]) != scan_keywords(identifiers[i])) {
+            fprintf(stderr, "lookups disagree on %s\n", identifiers[i]);
+            return 1;
+        }
+    }
+
+    // the sum of matches keeps the compiler from dropping the loops
+    volatile long found = 0;
+    double started = now_seconds();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) found += scan_keywords(identifiers[i]) != NULL;
+    }
+    const double linear = now_seconds() - started;
+
+    started = now_seconds();
+    for (long r = 0; r < rounds; r++) {
+        for (int i = 0; i < count; i++) found += find_keyword(identifiers[i], lengths[i]) != NULL;
+    }
+    const double hashed = now_seconds() - started;
+
+    const double lookups = (double)rounds * count;
+    printf("{\"benchmark\": \"keywords\", \"lookups\": %.0f, \"linear_ns\": %.2f, \"perfect_hash_ns\": %.2f, "
+           "\"speedup\": %.1f}\n",
+           lookups, linear * 1e9 / lookups, hashed * 1e9 / lookups, hashed > 0 ? linear / hashed : 0.0);
+    return 0;
+}
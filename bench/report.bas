@@ -0,0 +1,10 @@
+10 REM PRINT-heavy report: a table of 300000 rows
+20 T = 0
+30 FOR I = 1 TO 300000
+40 Q = I MOD 97 + 1
+50 P = Q * 1.25
+60 T = T + Q * P
+70 PRINT "item "; I; ", qty "; Q; ", price "; P; ", total "; T; "\n"
+80 NEXT I
+90 PRINT "grand total "; T; "\n"
+100 END
@@ -0,0 +1,20 @@
+10 REM sieve of Eratosthenes: primes below 200000, five times over
+20 N% = 200000
+30 DIM F%(200000)
+40 FOR R% = 1 TO 5
+50 FOR I% = 2 TO N%
+60 F%(I%) = 1
+70 NEXT I%
+80 FOR I% = 2 TO 447
+90 IF F%(I%) = 0 THEN GOTO 130
+100 FOR J% = I% * I% TO N% STEP I%
+110 F%(J%) = 0
+120 NEXT J%
+130 NEXT I%
+140 NEXT R%
+150 C% = 0
+160 FOR I% = 2 TO N%
+170 C% = C% + F%(I%)
+180 NEXT I%
+190 PRINT "primes below 200000: "; C%; "\n"
+200 END
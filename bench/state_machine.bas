@@ -0,0 +1,26 @@
+10 REM GOTO state machine: counts words, digits and spaces in a generated stream
+20 W = 0
+30 D = 0
+40 B = 0
+50 S = 0
+60 FOR I = 1 TO 1000000
+70 C = (I * 7 + I \ 3) MOD 13
+80 IF S = 1 THEN GOTO 200
+90 IF S = 2 THEN GOTO 300
+100 REM state 0: between words
+110 IF C < 3 THEN GOTO 400
+120 IF C < 9 THEN S = 1
+130 IF C >= 9 THEN S = 2
+140 GOTO 500
+200 REM state 1: in a word
+210 IF C < 3 THEN S = 0
+220 IF C < 3 THEN W = W + 1
+230 GOTO 500
+300 REM state 2: in a number
+310 D = D + 1
+320 IF C < 9 THEN S = 0
+330 GOTO 500
+400 B = B + 1
+500 NEXT I
+510 PRINT "words "; W; " digits "; D; " blanks "; B; "\n"
+520 END
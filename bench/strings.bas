@@ -0,0 +1,15 @@
+10 REM string building: append characters and numbers, then measure and convert
+20 T = 0
+30 FOR R = 1 TO 3000
+40 S$ = ""
+50 FOR I = 1 TO 200
+60 S$ = S$ + CHR$(65 + I MOD 26)
+70 NEXT I
+80 FOR I = 1 TO 100
+90 N$ = STR$(R * I) + "," + STR$(I / 8)
+100 T = T + LEN(N$) + ASC(N$) + VAL(STR$(I))
+110 NEXT I
+120 T = T + LEN(S$) + ASC(S$ + "")
+130 NEXT R
+140 PRINT "checksum "; T; "\n"
+150 END
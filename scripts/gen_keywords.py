@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Generates src/tokenizer/keywords.c, a perfect hash over the BASIC keywords.
+
+hash(word) = len(word) + asso[word[0]] + asso[word[-2]] + asso[word[-1]]
+
+The association values are searched until every keyword lands in its own
+slot. Letters are folded to upper case inside the association table, so
+lookups need no separate case folding.
+
+Usage: python3 scripts/gen_keywords.py > src/tokenizer/keywords.c
+"""
+import random
+import sys
+
+KEYWORDS = [
+    # commands
+    ("PRINT", "TOKEN_COMMAND", "CMD_PRINT"),
+    ("LET", "TOKEN_COMMAND", "CMD_LET"),
+    ("INPUT", "TOKEN_COMMAND", "CMD_INPUT"),
+    ("IF", "TOKEN_COMMAND", "CMD_IF"),
+    ("THEN", "TOKEN_COMMAND", "CMD_THEN"),
+    ("ELSE", "TOKEN_COMMAND", "CMD_ELSE"),
+    ("GOTO", "TOKEN_COMMAND", "CMD_GOTO"),
+    ("GOSUB", "TOKEN_COMMAND", "CMD_GOSUB"),
+    ("RETURN", "TOKEN_COMMAND", "CMD_RETURN"),
+    ("FOR", "TOKEN_COMMAND", "CMD_FOR"),
+    ("TO", "TOKEN_COMMAND", "CMD_TO"),
+    ("STEP", "TOKEN_COMMAND", "CMD_STEP"),
+    ("NEXT", "TOKEN_COMMAND", "CMD_NEXT"),
+    ("END", "TOKEN_COMMAND", "CMD_END"),
+    ("REM", "TOKEN_COMMAND", "CMD_REM"),
+    ("DATA", "TOKEN_COMMAND", "CMD_DATA"),
+    ("READ", "TOKEN_COMMAND", "CMD_READ"),
+    ("RESTORE", "TOKEN_COMMAND", "CMD_RESTORE"),
+    ("DIM", "TOKEN_COMMAND", "CMD_DIM"),
+    ("MAT", "TOKEN_COMMAND", "CMD_MAT"),
+    ("DEF", "TOKEN_COMMAND", "CMD_DEF"),
+    ("ON", "TOKEN_COMMAND", "CMD_ON"),
+    ("STOP", "TOKEN_COMMAND", "CMD_STOP"),
+    ("RUN", "TOKEN_COMMAND", "CMD_RUN"),
+    ("LIST", "TOKEN_COMMAND", "CMD_LIST"),
+    ("NEW", "TOKEN_COMMAND", "CMD_NEW"),
+    ("CLEAR", "TOKEN_COMMAND", "CMD_CLEAR"),
+    # word operators
+    ("MOD", "TOKEN_OPERATOR", "OP_MOD"),
+    ("AND", "TOKEN_OPERATOR", "OP_AND"),
+    ("OR", "TOKEN_OPERATOR", "OP_OR"),
+    ("NOT", "TOKEN_OPERATOR", "OP_NOT"),
+    # functions
+    ("ABS", "TOKEN_FUNCTION", "FUNC_ABS"),
+    ("SIN", "TOKEN_FUNCTION", "FUNC_SIN"),
+    ("COS", "TOKEN_FUNCTION", "FUNC_COS"),
+    ("TAN", "TOKEN_FUNCTION", "FUNC_TAN"),
+    ("SQR", "TOKEN_FUNCTION", "FUNC_SQR"),
+    ("INT", "TOKEN_FUNCTION", "FUNC_INT"),
+    ("RND", "TOKEN_FUNCTION", "FUNC_RND"),
+    ("LEN", "TOKEN_FUNCTION", "FUNC_LEN"),
+    ("LEFT$", "TOKEN_FUNCTION", "FUNC_LEFT"),
+    ("RIGHT$", "TOKEN_FUNCTION", "FUNC_RIGHT"),
+    ("MID$", "TOKEN_FUNCTION", "FUNC_MID"),
+    ("VAL", "TOKEN_FUNCTION", "FUNC_VAL"),
+    ("STR$", "TOKEN_FUNCTION", "FUNC_STR"),
+    ("CHR$", "TOKEN_FUNCTION", "FUNC_CHR"),
+    ("ASC", "TOKEN_FUNCTION", "FUNC_ASC"),
+]
+
+MAX_ASSO = 64
+
+
+def hash_word(word, asso):
+    return len(word) + asso[word[0]] + asso[word[-2]] + asso[word[-1]]
+
+
+def collisions(asso, table_size):
+    seen = set()
+    bad = 0
+    for word, _, _ in KEYWORDS:
+        h = hash_word(word, asso)
+        if h >= table_size or h in seen:
+            bad += 1
+        seen.add(h)
+    return bad
+
+
+def search(table_size, attempts=10, steps=3000):
+    # local search: perturb one association value at a time, keeping changes that do not add collisions
+    chars = sorted({c for word, _, _ in KEYWORDS for c in (word[0], word[-2], word[-1])})
+    rng = random.Random(1)
+    for _ in range(attempts):
+        asso = {c: rng.randrange(MAX_ASSO) for c in chars}
+        bad = collisions(asso, table_size)
+        for _ in range(steps):
+            if bad == 0:
+                return asso
+            c = rng.choice(chars)
+            old = asso[c]
+            asso[c] = rng.randrange(MAX_ASSO)
+            new_bad = collisions(asso, table_size)
+            if new_bad <= bad:
+                bad = new_bad
+            else:
+                asso[c] = old
+    return None
+
+
+def main():
+    table_size = len(KEYWORDS)
+    while True:
+        asso = search(table_size)
+        if asso:
+            break
+        table_size += 1
+
+    max_length = max(len(word) for word, _, _ in KEYWORDS)
+    values = [table_size] * 256
+    for c, v in asso.items():
+        values[ord(c)] = v
+        values[ord(c.lower())] = v
+
+    slots = [None] * table_size
+    for entry in KEYWORDS:
+        slots[hash_word(entry[0], asso)] = entry
+
+    out = sys.stdout
+    out.write("// generated by scripts/gen_keywords.py, edit the keyword list there and rerun\n")
+    out.write('#include "interpreter/basic_interpreter.h"\n\n')
+    out.write("#define MIN_KEYWORD_LENGTH 2\n")
+    out.write("#define MAX_KEYWORD_LENGTH %d\n" % max_length)
+    out.write("#define KEYWORD_SLOTS %d\n\n" % table_size)
+    out.write("// letters map to the same value in either case, other characters fall outside the table\n")
+    out.write("static const unsigned char asso_values[256] = {\n")
+    for i in range(0, 256, 16):
+        out.write("    " + ", ".join("%2d" % v for v in values[i:i + 16]) + ",\n")
+    out.write("};\n\n")
+    out.write("static const Keyword keyword_slots[KEYWORD_SLOTS] = {\n")
+    for i, entry in enumerate(slots):
+        if entry:
+            out.write('    [%d] = {"%s", %s, %s},\n' % (i, entry[0], entry[1], entry[2]))
+    out.write("};\n\n")
+    out.write("""// one hash and at most one compare per identifier
+const Keyword *find_keyword(const char *text, size_t length) {
+    if (!text || length < MIN_KEYWORD_LENGTH || length > MAX_KEYWORD_LENGTH) return NULL;
+
+    const unsigned char *word = (const unsigned char *)text;
+    const unsigned int hash = (unsigned int)length + asso_values[word[0]] +
+                              asso_values[word[length - 2]] + asso_values[word[length - 1]];
+    if (hash >= KEYWORD_SLOTS) return NULL;
+
+    const Keyword *keyword = &keyword_slots[hash];
+    if (!keyword->name || strncasecmp(text, keyword->name, length) != 0 || keyword->name[length] != '\\0') {
+        return NULL;
+    }
+    return keyword;
+}
+""")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,327 +1,382 @@
 #include "interpreter/basic_interpreter.h"
 
-int parse_line(Interpreter *interp, const char *line_text) {
-    if (!interp || !line_text) {
-        return 0;
-    }
+#ifndef _WIN32
+#include <stdatomic.h>
+#endif
+
+// the --sample signal handler reads the GOSUB stack wherever the program is
+// interrupted, so the compiler must not move stores to it across a fence
+static void fence_gosub_stack(void) {
+#ifndef _WIN32
+    atomic_signal_fence(memory_order_release);
+#endif
+}
 
-    if (interp->line_count >= MAX_LINES) {
-        print_error(interp, "Too many lines");
+// tokenizes and parses one numbered source line into the program arena;
+// *has_body is 0 for a bare line number
+static int build_line(Interpreter *interp, const char *line_text, int default_number, Line *line, int *has_body) {
+    if (!tokenize_line(&interp->arena, line_text, strlen(line_text), default_number, line)) {
+        print_error(interp, "Tokenization failed");
         return 0;
     }
+    *has_body = line->text[0] != '\0';
 
-    const char *ptr = line_text;
-    while (isspace(*ptr)) ptr++;
-    if (!*ptr || *ptr == '\n') return 1;
-
-    Line *line = &interp->lines[interp->line_count];
-
-    // get the line number
-    if (isdigit(*ptr)) {
-        line->line_number = atoi(ptr);
-        while (isdigit(*ptr)) ptr++;
-        while (isspace(*ptr)) ptr++;
-    } else {
-        line->line_number = interp->line_count * 10 + 10;
-    }
-
-    // allocate and copy text
-    size_t text_len = strlen(ptr);
-    line->text = malloc(text_len + 1);
-    if (!line->text) {
+    // build the statement tree once, execution never looks at the tokens again
+    line->statement = parse_statement(interp, &interp->arena, line->tokens, line->token_count);
+    if (!line->statement) {
         print_error(interp, "Memory allocation failed");
         return 0;
     }
-    strcpy(line->text, ptr);
+    return 1;
+}
 
-    // tokenize the line
-    line->tokens = tokenize(ptr, &line->token_count);
-    if (!line->tokens && line->token_count > 0) {
-        free(line->text);
-        line->text = NULL;
-        print_error(interp, "Tokenization failed");
+// enters a line the way the REPL does: a new number inserts, an existing one
+// is replaced and a bare line number deletes the line
+int parse_line(Interpreter *interp, const char *line_text) {
+    if (!interp || !line_text) {
         return 0;
     }
 
-    interp->line_count++;
-    return 1;
-}
+    const char *ptr = line_text;
+    while (isspace(*ptr)) ptr++;
+    if (!*ptr || *ptr == '\n') return 1;
 
-int execute_print(Interpreter *interp, Token *tokens, int token_count, int start) {
-    if (!interp || !tokens) {
+    Line line;
+    int has_body;
+    if (!build_line(interp, ptr, interp->line_count * 10 + 10, &line, &has_body)) {
         return 0;
     }
 
-    if (start >= token_count) {
+    if (!has_body) {
+        delete_line(interp, line.line_number);
         return 1;
     }
+    return store_line(interp, &line);
+}
 
-    int i = start;
-    while (i < token_count) {
-        int expr_end = i;
-        int paren_level = 0;
+int execute_print(Interpreter *interp, const Statement *stmt) {
+    if (!interp || !stmt) {
+        return 0;
+    }
 
-        while (expr_end < token_count) {
-            if (tokens[expr_end].type == TOKEN_DELIMITER && tokens[expr_end].text && strcmp(tokens[expr_end].text, "(") == 0) {
-                paren_level++;
-            } else if (tokens[expr_end].type == TOKEN_DELIMITER && tokens[expr_end].text && strcmp(tokens[expr_end].text, ")") == 0) {
-                paren_level--;
-            } else if (paren_level == 0 && tokens[expr_end].type == TOKEN_DELIMITER && tokens[expr_end].text &&
-                      (strcmp(tokens[expr_end].text, ",") == 0 || strcmp(tokens[expr_end].text, ";") == 0)) {
-                break;
-            }
-            expr_end++;
-        }
+    for (int i = 0; i < stmt->item_count; i++) {
+        const PrintItem *item = &stmt->items[i];
 
-        if (expr_end > i) {
-            Value result = evaluate_expression(interp, tokens, i, expr_end - 1);
-            if (result.type == VALUE_NUMBER) {
-                printf("%.6g", result.data.number);
-            } else if (result.type == VALUE_STRING && result.data.string) {
-                printf("%s", result.data.string);
+        if (item->expr) {
+            Value result = evaluate_node(interp, item->expr);
+            if (strlen(interp->error_message) > 0) {
+                cleanup_value(&result);
+                return 0;
             }
+            write_value(interp, &result);
             cleanup_value(&result);
         }
 
-        // separator block
-        if (expr_end < token_count && tokens[expr_end].type == TOKEN_DELIMITER && tokens[expr_end].text) {
-            if (strcmp(tokens[expr_end].text, ",") == 0) {
-                printf("\t");
-            } else if (strcmp(tokens[expr_end].text, ";") == 0) {
-                // nothing happens, no separator has been found
-            }
-            i = expr_end + 1;
-        } else {
-            break;
+        // separator block, ';' prints nothing
+        if (item->separator == ',') {
+            write_output(interp, "\t", 1);
         }
     }
 
     return 1;
 }
 
-int execute_let(Interpreter *interp, Token *tokens, int token_count, int start) {
-    if (!interp || !tokens || start + 2 >= token_count) {
+int execute_let(Interpreter *interp, const Statement *stmt) {
+    if (!interp || !stmt || !stmt->target || !stmt->expr) {
         print_error(interp, "Invalid LET statement");
         return 0;
     }
 
-    if (tokens[start].type != TOKEN_VARIABLE ||
-        tokens[start + 1].type != TOKEN_OPERATOR || 
-        tokens[start + 1].operator != OP_EQUAL) {
-        print_error(interp, "Invalid LET statement");
-        return 0;
+    if (stmt->operand_count > 0) {
+        // every operand is evaluated before the target is touched
+        Value operands[MAX_APPEND_OPERANDS];
+        for (int i = 0; i < stmt->operand_count; i++) {
+            operands[i] = evaluate_node(interp, stmt->operands[i]);
+            if (strlen(interp->error_message) > 0) {
+                for (int j = 0; j <= i; j++) cleanup_value(&operands[j]);
+                return 0;
+            }
+        }
+        return append_to_variable(interp, stmt->target->slot, operands, stmt->operand_count);
     }
 
-    if (!tokens[start].text) {
-        print_error(interp, "Invalid variable name");
+    // subscripts are evaluated before the value, as the VM does
+    Value subscripts[MAX_ARRAY_DIMENSIONS];
+    const Node *target = stmt->target;
+    if (target->type == NODE_ARRAY && !evaluate_arguments(interp, target, subscripts)) {
         return 0;
     }
 
-    char *var_name = tokens[start].text;
-    Value value = evaluate_expression(interp, tokens, start + 2, token_count - 1);
-    set_variable(interp, var_name, value);
-
-    return 1;
+    Value value = evaluate_node(interp, stmt->expr);
+    if (strlen(interp->error_message) > 0) {
+        cleanup_value(&value);
+        if (target->type == NODE_ARRAY) {
+            for (int i = 0; i < target->arg_count; i++) cleanup_value(&subscripts[i]);
+        }
+        return 0;
+    }
+    if (target->type == NODE_ARRAY) {
+        return store_element(interp, target->slot, subscripts, target->arg_count, value);
+    }
+    return set_variable_slot(interp, target->slot, value);
 }
 
-int execute_input(Interpreter *interp, Token *tokens, int token_count, int start) {
-    if (!interp || !tokens) {
+// INPUT A, B(I): each subscript is evaluated just before its value is read, as in READ
+int execute_input(Interpreter *interp, const Statement *stmt) {
+    if (!interp || !stmt) {
         return 0;
     }
 
-    char input_buffer[MAX_INPUT_LENGTH];
+    for (int i = 0; i < stmt->operand_count; i++) {
+        const Node *target = stmt->operands[i];
+        Value subscripts[MAX_ARRAY_DIMENSIONS];
+        if (target->type == NODE_ARRAY && !evaluate_arguments(interp, target, subscripts)) {
+            return 0;
+        }
 
-    // check prompt as char*
-    int var_start = start;
-    if (start < token_count && tokens[start].type == TOKEN_STRING) {
-        if (tokens[start].value.data.string) {
-            printf("%s", tokens[start].value.data.string);
+        Value value;
+        if (!read_input_value(interp, i == 0 ? stmt->prompt : NULL, i, stmt->operand_count, &value)) {
+            if (target->type == NODE_ARRAY) {
+                for (int j = 0; j < target->arg_count; j++) cleanup_value(&subscripts[j]);
+            }
+            // the end of input leaves the variable as it was
+            if (strlen(interp->error_message) > 0) return 0;
+            continue;
         }
-        var_start = start + 1;
-        if (var_start < token_count && tokens[var_start].type == TOKEN_DELIMITER &&
-            tokens[var_start].text && strcmp(tokens[var_start].text, ";") == 0) {
-            var_start++;
+        const int stored = target->type == NODE_ARRAY ?
+            store_element(interp, target->slot, subscripts, target->arg_count, value) :
+            set_variable_slot(interp, target->slot, value);
+        if (!stored) return 0;
+    }
+    return 1;
+}
+
+int execute_dim(Interpreter *interp, const Statement *stmt) {
+    for (int i = 0; i < stmt->operand_count; i++) {
+        const Node *array = stmt->operands[i];
+        Value bounds[MAX_ARRAY_DIMENSIONS];
+        if (!evaluate_arguments(interp, array, bounds) ||
+            !dimension_array(interp, array->slot, bounds, array->arg_count)) {
+            return 0;
         }
     }
+    return 1;
+}
 
-    if (var_start >= token_count || tokens[var_start].type != TOKEN_VARIABLE) {
-        print_error(interp, "INPUT requires a variable");
-        return 0;
+// READ assigns the next DATA items the way LET assigns values
+static int execute_read(Interpreter *interp, const Statement *stmt) {
+    for (int i = 0; i < stmt->operand_count; i++) {
+        const Node *target = stmt->operands[i];
+        Value subscripts[MAX_ARRAY_DIMENSIONS];
+        if (target->type == NODE_ARRAY && !evaluate_arguments(interp, target, subscripts)) {
+            return 0;
+        }
+
+        Value value;
+        if (!read_data(interp, &value)) {
+            if (target->type == NODE_ARRAY) {
+                for (int j = 0; j < target->arg_count; j++) cleanup_value(&subscripts[j]);
+            }
+            return 0;
+        }
+        const int stored = target->type == NODE_ARRAY ?
+            store_element(interp, target->slot, subscripts, target->arg_count, value) :
+            set_variable_slot(interp, target->slot, value);
+        if (!stored) return 0;
     }
+    return 1;
+}
 
-    if (!tokens[var_start].text) {
-        print_error(interp, "Invalid variable name");
-        return 0;
+// MAT: the scale factor or the new bounds are evaluated here, the arrays are worked on whole
+static int execute_mat(Interpreter *interp, const Statement *stmt) {
+    Value args[MAX_ARRAY_DIMENSIONS];
+    int count = 0;
+    if (stmt->expr) {
+        args[0] = evaluate_node(interp, stmt->expr);
+        count = 1;
+        if (strlen(interp->error_message) > 0) {
+            cleanup_value(&args[0]);
+            return 0;
+        }
+    } else if (stmt->target->type == NODE_ARRAY) {
+        if (!evaluate_arguments(interp, stmt->target, args)) return 0;
+        count = stmt->target->arg_count;
     }
 
-    printf("? ");
-    if (fgets(input_buffer, sizeof(input_buffer), stdin)) {
-        char *newline = strchr(input_buffer, '\n');
-        if (newline) *newline = '\0';
+    const int left = stmt->operand_count > 0 ? stmt->operands[0]->slot : -1;
+    const int right = stmt->operand_count > 1 ? stmt->operands[1]->slot : -1;
+    return assign_matrix(interp, stmt->mat_op, stmt->target->slot, left, right, args, count);
+}
 
-        // num?
-        char *endptr;
-        double num = strtod(input_buffer, &endptr);
+// targets are resolved before a run, -1 means the line does not exist
+static int find_jump(Interpreter *interp, int line_index) {
+    if (line_index == -1) {
+        print_error(interp, "Line number not found");
+    }
+    return line_index;
+}
 
-        Value value;
-        if (*endptr == '\0' && endptr != input_buffer) {
-            // valid number found
-            value = create_number_value(num);
-        } else {
-            // treat as string
-            value = create_string_value(input_buffer);
-        }
+static int jump_to_line(Interpreter *interp, int line_index) {
+    if (find_jump(interp, line_index) == -1) return 0;
+    interp->current_line = line_index - 1; // -1 because execute_program will increment
+    return 1;
+}
 
-        set_variable(interp, tokens[var_start].text, value);
-    }
+static int call_line(Interpreter *interp, int line_index) {
+    // push return address (next line after current)
+    if (find_jump(interp, line_index) == -1 || !push_gosub(interp, interp->current_line + 1, line_index)) return 0;
+    interp->current_line = line_index - 1;
+    return 1;
+}
+
+// consumes the selector; n picks the nth of count targets, anything outside 1..count falls through with -1
+int select_jump(Interpreter *interp, Value selector, int count, int *choice) {
+    long long n;
+    const int ok = to_integer(interp, selector, &n);
+    cleanup_value(&selector);
+    if (!ok) return 0;
 
+    *choice = n >= 1 && n <= count ? (int)n - 1 : -1;
     return 1;
 }
 
-int execute_if(Interpreter *interp, Token *tokens, int token_count, int start) {
-    if (!interp || !tokens) {
+static int execute_on(Interpreter *interp, const Statement *stmt) {
+    Value selector = evaluate_node(interp, stmt->expr);
+    if (strlen(interp->error_message) > 0) {
+        cleanup_value(&selector);
         return 0;
     }
 
-    int then_pos = -1;
-    for (int i = start; i < token_count; i++) {
-        if (tokens[i].type == TOKEN_COMMAND && tokens[i].command == CMD_THEN) {
-            then_pos = i;
-            break;
-        }
+    int choice;
+    if (!select_jump(interp, selector, stmt->target_count, &choice)) return 0;
+    if (choice == -1) return 1;
+
+    if (stmt->on_command == CMD_GOSUB) {
+        return call_line(interp, stmt->target_indices[choice]);
     }
+    return jump_to_line(interp, stmt->target_indices[choice]);
+}
 
-    if (then_pos == -1) {
-        print_error(interp, "IF without THEN");
+int execute_if(Interpreter *interp, const Statement *stmt) {
+    if (!interp || !stmt) {
         return 0;
     }
 
-    Value condition = evaluate_expression(interp, tokens, start, then_pos - 1);
-    const int is_true = condition.type == VALUE_NUMBER && condition.data.number != 0;
+    Value condition = evaluate_node(interp, stmt->expr);
+    if (strlen(interp->error_message) > 0) {
+        cleanup_value(&condition);
+        return 0;
+    }
+    const int is_true = condition.type != VALUE_STRING && to_number(condition) != 0;
     cleanup_value(&condition);
 
-    if (is_true) {
-        // execute THEN clause
-        if (then_pos + 1 < token_count) {
-            if (tokens[then_pos + 1].type == TOKEN_NUMBER) {
-                // GOTO line number
-                int line_num = (int)tokens[then_pos + 1].value.data.number;
-                int line_index = find_line_by_number(interp, line_num);
-                if (line_index != -1) {
-                    interp->current_line = line_index - 1; // -1 because execute_program will increment
-                    return 1;
-                } else {
-                    print_error(interp, "Line number not found");
-                    return 0;
-                }
-            } else {
-                // execute remaining tokens as a statement
-                return execute_line_tokens(interp, tokens, token_count, then_pos + 1);
-            }
-        }
+    if (!is_true) {
+        return 1;
     }
 
+    // execute THEN clause
+    if (stmt->then_statement) {
+        return execute_statement(interp, stmt->then_statement);
+    }
+    if (stmt->target_line >= 0) {
+        return jump_to_line(interp, stmt->target_index);
+    }
     return 1;
 }
 
-int execute_for(Interpreter *interp, Token *tokens, int token_count, int start) {
-    if (!interp || !tokens || start + 4 >= token_count) {
-        print_error(interp, "Invalid FOR statement");
-        return 0;
+// whole numbers small enough that counter + increment stays exact as a double
+static int is_integral(double number) {
+    return number == floor(number) && fabs(number) <= MAX_INTEGRAL_FOR;
+}
+
+int begin_for_loop(Interpreter *interp, int slot, Value start_val, Value end_val, Value step_val) {
+    const char *message = NULL;
+    if (start_val.type == VALUE_STRING) {
+        message = "FOR start value must be numeric";
+    } else if (end_val.type == VALUE_STRING) {
+        message = "FOR end value must be numeric";
+    } else if (step_val.type == VALUE_STRING) {
+        message = "FOR step value must be numeric";
+    } else if (interp->for_stack_top + 1 >= MAX_STACK_DEPTH) {
+        message = "FOR stack overflow";
+    } else if (interp->for_stack_top + 1 >= interp->for_stack_capacity) {
+        ForLoop *stack = grow_array(interp->for_stack, &interp->for_stack_capacity, sizeof(ForLoop));
+        if (stack) {
+            interp->for_stack = stack;
+        } else {
+            message = "Out of memory";
+        }
     }
 
-    if (tokens[start].type != TOKEN_VARIABLE ||
-        tokens[start + 1].type != TOKEN_OPERATOR || 
-        tokens[start + 1].operator != OP_EQUAL) {
-        print_error(interp, "Invalid FOR statement");
+    if (message) {
+        print_error(interp, message);
+        cleanup_value(&start_val);
+        cleanup_value(&end_val);
+        cleanup_value(&step_val);
         return 0;
     }
 
-    if (!tokens[start].text) {
-        print_error(interp, "Invalid variable name");
+    const double start = to_number(start_val);
+
+    // set initial variable value
+    if (!set_variable_slot(interp, slot, start_val)) {
         return 0;
     }
 
-    char *var_name = tokens[start].text;
+    // push onto FOR stack
+    ForLoop *loop = &interp->for_stack[++interp->for_stack_top];
+    loop->slot = slot;
+    loop->start = start;
+    loop->end = to_number(end_val);
+    loop->step = to_number(step_val);
+    loop->body_line = interp->current_line + 1;
 
-    // look for TO keyword
-    int to_pos = -1;
-    for (int i = start + 2; i < token_count; i++) {
-        if (tokens[i].type == TOKEN_COMMAND && tokens[i].command == CMD_TO) {
-            to_pos = i;
-            break;
-        }
+    loop->integral = is_integral(loop->start) && is_integral(loop->end) && is_integral(loop->step);
+    if (loop->integral) {
+        loop->counter = (long long)loop->start;
+        loop->limit = (long long)loop->end;
+        loop->increment = (long long)loop->step;
     }
 
-    if (to_pos == -1) {
-        print_error(interp, "FOR without TO");
-        return 0;
-    }
+    return 1;
+}
 
-    // STEP? (optional)
-    int step_pos = -1;
-    for (int i = to_pos + 1; i < token_count; i++) {
-        if (tokens[i].type == TOKEN_COMMAND && tokens[i].command == CMD_STEP) {
-            step_pos = i;
-            break;
-        }
+int execute_for(Interpreter *interp, const Statement *stmt) {
+    if (!interp || !stmt || !stmt->target) {
+        print_error(interp, "Invalid FOR statement");
+        return 0;
     }
 
-    Value start_val = evaluate_expression(interp, tokens, start + 2, to_pos - 1);
-    if (start_val.type != VALUE_NUMBER) {
-        print_error(interp, "FOR start value must be numeric");
+    Value start_val = evaluate_node(interp, stmt->expr);
+    if (strlen(interp->error_message) > 0) {
         cleanup_value(&start_val);
         return 0;
     }
 
-    int end_expr_end = (step_pos != -1) ? step_pos - 1 : token_count - 1;
-    Value end_val = evaluate_expression(interp, tokens, to_pos + 1, end_expr_end);
-    if (end_val.type != VALUE_NUMBER) {
-        print_error(interp, "FOR end value must be numeric");
+    Value end_val = evaluate_node(interp, stmt->end_expr);
+    if (strlen(interp->error_message) > 0) {
         cleanup_value(&start_val);
         cleanup_value(&end_val);
         return 0;
     }
 
-    double step = 1.0;
-    if (step_pos != -1) {
-        Value step_val = evaluate_expression(interp, tokens, step_pos + 1, token_count - 1);
-        if (step_val.type != VALUE_NUMBER) {
-            print_error(interp, "FOR step value must be numeric");
+    Value step_val = create_number_value(1.0);
+    if (stmt->step_expr) {
+        step_val = evaluate_node(interp, stmt->step_expr);
+        if (strlen(interp->error_message) > 0) {
             cleanup_value(&start_val);
             cleanup_value(&end_val);
             cleanup_value(&step_val);
             return 0;
         }
-        step = step_val.data.number;
-        cleanup_value(&step_val);
-    }
-
-    // set initial variable value
-    set_variable(interp, var_name, start_val);
-
-    // push onto FOR stack
-    if (interp->for_stack_top >= MAX_FOR_STACK - 1) {
-        print_error(interp, "FOR stack overflow");
-        cleanup_value(&start_val);
-        cleanup_value(&end_val);
-        return 0;
     }
 
-    ForLoop *loop = &interp->for_stack[++interp->for_stack_top];
-    strncpy(loop->variable, var_name, sizeof(loop->variable) - 1);
-    loop->variable[sizeof(loop->variable) - 1] = '\0';
-    loop->start = start_val.data.number;
-    loop->end = end_val.data.number;
-    loop->step = step;
-    loop->line_index = interp->current_line;
-
-    cleanup_value(&start_val);
-    cleanup_value(&end_val);
-    return 1;
+    return begin_for_loop(interp, stmt->target->slot, start_val, end_val, step_val);
 }
 
-int execute_next(Interpreter *interp) {
+int step_for_loop(Interpreter *interp, int *continue_loop) {
+    *continue_loop = 0;
+
     if (!interp || interp->for_stack_top < 0) {
         print_error(interp, "NEXT without FOR");
         return 0;
@@ -329,26 +384,44 @@ int execute_next(Interpreter *interp) {
 
     ForLoop *loop = &interp->for_stack[interp->for_stack_top];
 
-    Variable *var = get_variable(interp, loop->variable);
-    if (!var || var->value.type != VALUE_NUMBER) {
+    Variable *var = &interp->variables[loop->slot];
+    if (!var->defined || var->value.type == VALUE_STRING) {
         print_error(interp, "FOR variable not found");
         return 0;
     }
 
-    // increment variable
-    var->value.data.number += loop->step;
-
-    // check if loop should continue
-    int continue_loop = 0;
-    if (loop->step > 0) {
-        continue_loop = (var->value.data.number <= loop->end);
+    // the counter only stays authoritative while the body leaves the variable alone
+    if (loop->integral && (var->integer ? var->value.data.integer == loop->counter :
+                                          var->value.data.number == (double)loop->counter)) {
+        loop->counter += loop->increment;
+        if (var->integer) {
+            var->value.data.integer = loop->counter;
+        } else {
+            var->value.data.number = (double)loop->counter;
+        }
+        *continue_loop = loop->increment > 0 ? loop->counter <= loop->limit : loop->counter >= loop->limit;
     } else {
-        continue_loop = (var->value.data.number >= loop->end);
+        loop->integral = 0;
+
+        // increment variable, an A% variable rounds like any assignment
+        if (var->integer) {
+            if (!set_variable_slot(interp, loop->slot, create_number_value(to_number(var->value) + loop->step))) {
+                return 0;
+            }
+        } else {
+            var->value.data.number += loop->step;
+        }
+
+        // check if loop should continue
+        const double value = to_number(var->value);
+        if (loop->step > 0) {
+            *continue_loop = (value <= loop->end);
+        } else {
+            *continue_loop = (value >= loop->end);
+        }
     }
 
-    if (continue_loop) {
-        interp->current_line = loop->line_index;
-    } else {
+    if (!*continue_loop) {
         // pop FOR stack (loop is complete)
         interp->for_stack_top--;
     }
@@ -356,91 +429,127 @@ int execute_next(Interpreter *interp) {
     return 1;
 }
 
-int execute_line_tokens(Interpreter *interp, Token *tokens, int token_count, int start) {
-    if (!interp || !tokens || start >= token_count) return 1;
-
-    Token *token = &tokens[start];
-
-    if (token->type == TOKEN_COMMAND) {
-        switch (token->command) {
-            case CMD_PRINT:
-                return execute_print(interp, tokens, token_count, start + 1);
-            case CMD_LET:
-                return execute_let(interp, tokens, token_count, start + 1);
-            case CMD_INPUT:
-                return execute_input(interp, tokens, token_count, start + 1);
-            case CMD_IF:
-                return execute_if(interp, tokens, token_count, start + 1);
-            case CMD_FOR:
-                return execute_for(interp, tokens, token_count, start + 1);
-            case CMD_NEXT:
-                return execute_next(interp);
-            case CMD_GOTO: {
-                if (start + 1 >= token_count || tokens[start + 1].type != TOKEN_NUMBER) {
-                    print_error(interp, "GOTO requires line number");
-                    return 0;
-                }
-                int line_num = (int)tokens[start + 1].value.data.number;
-                int line_index = find_line_by_number(interp, line_num);
-                if (line_index != -1) {
-                    interp->current_line = line_index - 1;
-                    return 1;
-                } else {
-                    print_error(interp, "Line number not found");
-                    return 0;
-                }
-            }
-            case CMD_GOSUB: {
-                if (start + 1 >= token_count || tokens[start + 1].type != TOKEN_NUMBER) {
-                    print_error(interp, "GOSUB requires line number");
-                    return 0;
-                }
-
-                if (interp->gosub_stack_top >= MAX_GOSUB_STACK - 1) {
-                    print_error(interp, "GOSUB stack overflow");
-                    return 0;
-                }
-
-                // push return address (next line after current)
-                interp->gosub_stack[++interp->gosub_stack_top].return_line = interp->current_line + 1;
-
-                int line_num = (int)tokens[start + 1].value.data.number;
-                int line_index = find_line_by_number(interp, line_num);
-                if (line_index != -1) {
-                    interp->current_line = line_index - 1;
-                    return 1;
-                } else {
-                    print_error(interp, "Line number not found");
-                    return 0;
-                }
-            }
-            case CMD_RETURN: {
-                if (interp->gosub_stack_top < 0) {
-                    print_error(interp, "RETURN without GOSUB");
-                    return 0;
-                }
-
-                interp->current_line = interp->gosub_stack[interp->gosub_stack_top--].return_line - 1;
-                return 1;
-            }
-            case CMD_END:
-            case CMD_STOP:
-                interp->running = 0;
-                return 1;
-            case CMD_REM:
-                return 1; // REM is a comment, do nothing
-            default:
-                print_error(interp, "Unknown command");
-                return 0;
+int execute_next(Interpreter *interp) {
+    int continue_loop;
+    if (!step_for_loop(interp, &continue_loop)) {
+        return 0;
+    }
+
+    if (continue_loop) {
+        interp->current_line = interp->for_stack[interp->for_stack_top].body_line - 1;
+    }
+    return 1;
+}
+
+int push_gosub(Interpreter *interp, int return_line, int entry_line) {
+    if (interp->gosub_stack_top + 1 >= MAX_STACK_DEPTH) {
+        print_error(interp, "GOSUB stack overflow");
+        return 0;
+    }
+    if (interp->gosub_stack_top + 1 >= interp->gosub_stack_capacity) {
+        // not realloc: the sampler reads the stack from a signal handler, so
+        // the old array has to stay valid until the new one is in place
+        const int capacity = interp->gosub_stack_capacity ? interp->gosub_stack_capacity * 2 : 16;
+        GosubStack *stack = malloc(sizeof(GosubStack) * (size_t)capacity);
+        if (!stack) {
+            print_error(interp, "Out of memory");
+            return 0;
         }
+        GosubStack *old = interp->gosub_stack;
+        if (old) memcpy(stack, old, sizeof(GosubStack) * (size_t)(interp->gosub_stack_top + 1));
+        fence_gosub_stack();
+        interp->gosub_stack = stack;
+        interp->gosub_stack_capacity = capacity;
+        fence_gosub_stack();
+        free(old);
+    }
+
+    GosubStack *frame = &interp->gosub_stack[interp->gosub_stack_top + 1];
+    frame->return_line = return_line;
+    frame->entry_line = entry_line;
+    fence_gosub_stack();
+    interp->gosub_stack_top++;
+    return 1;
+}
+
+int pop_gosub(Interpreter *interp, int *return_line) {
+    if (interp->gosub_stack_top < 0) {
+        print_error(interp, "RETURN without GOSUB");
+        return 0;
     }
-    if (token->type == TOKEN_VARIABLE) {
-        // implicit LET
-        return execute_let(interp, tokens, token_count, start);
+
+    *return_line = interp->gosub_stack[interp->gosub_stack_top].return_line;
+    fence_gosub_stack();
+    interp->gosub_stack_top--;
+    return 1;
+}
+
+int execute_statement(Interpreter *interp, const Statement *stmt) {
+    if (!interp || !stmt) return 1;
+
+    if (stmt->error) {
+        print_error(interp, stmt->error);
+        return 0;
     }
 
-    print_error(interp, "Invalid statement");
-    return 0;
+    switch (stmt->command) {
+        case CMD_PRINT:
+            return execute_print(interp, stmt);
+        case CMD_LET:
+            return execute_let(interp, stmt);
+        case CMD_INPUT:
+            return execute_input(interp, stmt);
+        case CMD_IF:
+            return execute_if(interp, stmt);
+        case CMD_FOR:
+            return execute_for(interp, stmt);
+        case CMD_DIM:
+            return execute_dim(interp, stmt);
+        case CMD_MAT:
+            return execute_mat(interp, stmt);
+        case CMD_READ:
+            return execute_read(interp, stmt);
+        case CMD_DEF:
+            // the body was parsed with the line, defining only binds it
+            interp->functions[stmt->target->slot].definition = stmt;
+            return 1;
+        case CMD_RESTORE: {
+            // a RESTORE without a line number reads from the first DATA item
+            if (stmt->target_line >= 0 && stmt->target_index == -1) {
+                print_error(interp, "Line number not found");
+                return 0;
+            }
+            restore_data(interp, stmt->target_line >= 0 ? stmt->target_index : -1);
+            return 1;
+        }
+        case CMD_NEXT:
+            return execute_next(interp);
+        case CMD_GOTO:
+            return jump_to_line(interp, stmt->target_index);
+        case CMD_GOSUB:
+            return call_line(interp, stmt->target_index);
+        case CMD_ON:
+            return execute_on(interp, stmt);
+        case CMD_RETURN: {
+            int return_line;
+            if (!pop_gosub(interp, &return_line)) {
+                return 0;
+            }
+
+            interp->current_line = return_line - 1;
+            return 1;
+        }
+        case CMD_END:
+        case CMD_STOP:
+            interp->running = 0;
+            return 1;
+        case CMD_REM:
+        case CMD_DATA:
+            return 1; // REM is a comment, DATA was collected when the program was resolved
+        default:
+            print_error(interp, "Unknown command");
+            return 0;
+    }
 }
 
 int execute_line(Interpreter *interp, int line_index) {
@@ -449,23 +558,25 @@ int execute_line(Interpreter *interp, int line_index) {
     }
 
     Line *line = &interp->lines[line_index];
-    if (!line->tokens || line->token_count <= 0) {
+    if (!line->statement) {
         return 1; // empty line
     }
 
-    return execute_line_tokens(interp, line->tokens, line->token_count, 0);
+    return execute_statement(interp, line->statement);
 }
 
-int execute_program(Interpreter *interp) {
-    if (!interp) {
-        return 0;
-    }
-
+static int execute_lines(Interpreter *interp) {
     interp->running = 1;
     interp->current_line = 0;
 
     while (interp->running && interp->current_line < interp->line_count) {
-        if (!execute_line(interp, interp->current_line)) {
+        if (interp->profile) profile_line(interp, interp->current_line);
+
+        // NEXT closes every loop iteration, so it skips the generic dispatch
+        const Statement *stmt = interp->lines[interp->current_line].statement;
+        const int ok = stmt && stmt->command == CMD_NEXT && !stmt->error ?
+            execute_next(interp) : execute_line(interp, interp->current_line);
+        if (!ok) {
             return 0;
         }
         interp->current_line++;
@@ -474,37 +585,45 @@ int execute_program(Interpreter *interp) {
     return 1;
 }
 
-int load_program(Interpreter *interp, const char *filename) {
-    if (!interp || !filename) {
+int execute_program(Interpreter *interp) {
+    if (!interp) {
         return 0;
     }
 
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        printf("Error: Cannot open file %s\n", filename);
-        return 0;
-    }
+    // jump targets are looked up once per program change, not per jump
+    resolve_program(interp);
+    restore_data(interp, -1);
 
-    char line_buffer[MAX_LINE_LENGTH];
-    while (fgets(line_buffer, sizeof(line_buffer), file)) {
-        if (!parse_line(interp, line_buffer)) {
-            fclose(file);
-            return 0;
-        }
-    }
+    // a run that ended with an error can leave loops and GOSUB frames behind,
+    // which the next run and its profile must not see
+    interp->for_stack_top = -1;
+    interp->gosub_stack_top = -1;
 
-    fclose(file);
+    // functions are defined by the DEF statements this run executes, like
+    // under the VM, so a deleted DEF line no longer leaves its function behind
+    for (int i = 0; i < interp->function_count; i++) {
+        interp->functions[i].definition = NULL;
+    }
 
-    // sort lines by line number (bubble sort)
-    for (int i = 0; i < interp->line_count - 1; i++) {
-        for (int j = i + 1; j < interp->line_count; j++) {
-            if (interp->lines[i].line_number > interp->lines[j].line_number) {
-                Line temp = interp->lines[i];
-                interp->lines[i] = interp->lines[j];
-                interp->lines[j] = temp;
-            }
-        }
+    // a run that is not profiled or sampled drops the results of the last one
+    if (!interp->profiling) {
+        free_profile(interp->profile);
+        interp->profile = NULL;
+    } else if (!begin_profile(interp)) {
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+    if (interp->sample_interval == 0) {
+        free_samples(interp->samples);
+        interp->samples = NULL;
+    } else if (!start_sampling(interp)) {
+        return 0;
     }
 
-    return 1;
-}
\ No newline at end of file
+    const int ok = interp->use_vm ? execute_bytecode(interp) : execute_lines(interp);
+    interp->running = 0;
+    end_profile(interp);
+    if (interp->samples) stop_sampling(interp);
+    flush_output(interp);
+    return ok;
+}
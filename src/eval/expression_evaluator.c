@@ -1,34 +1,81 @@
 #include "interpreter/basic_interpreter.h"
 
-int get_precedence(const Operator op) {
+static int strings_equal(const String *a, const String *b) {
+    return a == b || (a->length == b->length && memcmp(a->data, b->data, a->length) == 0);
+}
+
+static int multiply_overflows(long long l, long long r) {
+    if (l == 0 || r == 0) return 0;
+    if (l > 0) {
+        return r > 0 ? l > LLONG_MAX / r : r < LLONG_MIN / l;
+    }
+    return r > 0 ? l < LLONG_MIN / r : l < LLONG_MAX / r;
+}
+
+// 64-bit arithmetic for A% values: overflow is an error rather than a silent wrap;
+// comparisons, AND, OR and NOT give 1 or 0 like they do on numbers
+Value apply_integer_operator(Interpreter *interp, long long l, Operator op, long long r) {
+    Value result = create_integer_value(0);
+
     switch (op) {
-        case OP_OR: 
-            return 1;
-        case OP_AND: 
-            return 2;
-        case OP_NOT: 
-            return 3;
+        case OP_PLUS:
+            if ((r > 0 && l > LLONG_MAX - r) || (r < 0 && l < LLONG_MIN - r)) goto overflow;
+            result.data.integer = l + r;
+            break;
+        case OP_MINUS:
+            if ((r < 0 && l > LLONG_MAX + r) || (r > 0 && l < LLONG_MIN + r)) goto overflow;
+            result.data.integer = l - r;
+            break;
+        case OP_MULTIPLY:
+            if (multiply_overflows(l, r)) goto overflow;
+            result.data.integer = l * r;
+            break;
+        case OP_INT_DIVIDE: // a \ b, truncates toward zero
+            if (r == 0) {
+                print_error(interp, "Division by zero");
+                break;
+            }
+            if (l == LLONG_MIN && r == -1) goto overflow;
+            result.data.integer = l / r;
+            break;
+        case OP_MOD:
+            if (r == 0) {
+                print_error(interp, "Division by zero in MOD");
+                break;
+            }
+            result.data.integer = r == -1 ? 0 : l % r;
+            break;
         case OP_EQUAL:
+            return create_number_value(l == r ? 1 : 0);
         case OP_NOT_EQUAL:
+            return create_number_value(l != r ? 1 : 0);
         case OP_LESS:
+            return create_number_value(l < r ? 1 : 0);
         case OP_LESS_EQUAL:
+            return create_number_value(l <= r ? 1 : 0);
         case OP_GREATER:
-        case OP_GREATER_EQUAL: 
-            return 4;
-        case OP_PLUS:
-        case OP_MINUS: 
-            return 5;
-        case OP_MULTIPLY:
+            return create_number_value(l > r ? 1 : 0);
+        case OP_GREATER_EQUAL:
+            return create_number_value(l >= r ? 1 : 0);
+        case OP_AND:
+            result.data.integer = l != 0 && r != 0;
+            break;
+        case OP_OR:
+            result.data.integer = l != 0 || r != 0;
+            break;
         case OP_DIVIDE:
-        case OP_MOD: 
-            return 6;
-        case OP_POWER: 
-            return 7;
-        case OP_ASSIGN:
-        case OP_UNKNOWN:
-        default: 
-            return 0;
+        case OP_POWER:
+            // always produce numbers
+            return apply_operator(interp, create_integer_value(l), op, create_integer_value(r));
+        default:
+            print_error(interp, "Unknown operator");
+            break;
     }
+    return result;
+
+overflow:
+    print_error(interp, "Integer overflow");
+    return result;
 }
 
 Value apply_operator(Interpreter *interp, Value left, Operator op, Value right) {
@@ -53,15 +100,18 @@ Value apply_operator(Interpreter *interp, Value left, Operator op, Value right)
             case OP_PLUS:
                 if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
                     // "str1" + "str2"
-                    size_t left_len = strlen(left.data.string);
-                    size_t right_len = strlen(right.data.string);
-                    char *concat = malloc(left_len + right_len + 1);
+                    const size_t left_len = left.data.string->length;
+                    const size_t right_len = right.data.string->length;
+                    // built in place, the operands are only read
+                    String *concat = malloc(sizeof(String) + left_len + right_len + 1);
                     if (concat) {
-                        strcpy(concat, left.data.string);
-                        strcat(concat, right.data.string);
-                        cleanup_value(&result); 
-                        result = create_string_value(concat);
-                        free(concat);
+                        concat->refcount = 1;
+                        concat->length = left_len + right_len;
+                        concat->capacity = concat->length;
+                        memcpy(concat->data, left.data.string->data, left_len);
+                        memcpy(concat->data + left_len, right.data.string->data, right_len + 1);
+                        result.type = VALUE_STRING;
+                        result.data.string = concat;
                     } else {
                         print_error(interp, "Memory allocation failed");
                     }
@@ -72,14 +122,14 @@ Value apply_operator(Interpreter *interp, Value left, Operator op, Value right)
             case OP_EQUAL:
                 if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
                     // "str1" = "str2"
-                    result.data.number = strcmp(left.data.string, right.data.string) == 0 ? 1 : 0;
+                    result.data.number = strings_equal(left.data.string, right.data.string) ? 1 : 0;
                 } else {
                     result.data.number = 0; // string != number
                 }
                 break;
             case OP_NOT_EQUAL:
                 if (left.type == VALUE_STRING && right.type == VALUE_STRING) {
-                    result.data.number = strcmp(left.data.string, right.data.string) != 0 ? 1 : 0;
+                    result.data.number = strings_equal(left.data.string, right.data.string) ? 0 : 1;
                 } else {
                     result.data.number = 1; // string != number
                 }
@@ -93,9 +143,21 @@ Value apply_operator(Interpreter *interp, Value left, Operator op, Value right)
         return result;
     }
 
+    // two integers stay integers, anything mixed with a number is computed as numbers
+    if (left.type == VALUE_INTEGER && right.type == VALUE_INTEGER && op != OP_DIVIDE && op != OP_POWER) {
+        return apply_integer_operator(interp, left.data.integer, op, right.data.integer);
+    }
+    if (op == OP_INT_DIVIDE) {
+        long long l, r;
+        if (!to_integer(interp, left, &l) || !to_integer(interp, right, &r)) {
+            return result;
+        }
+        return apply_integer_operator(interp, l, op, r);
+    }
+
     // num ops
-    const double l = left.data.number;
-    const double r = right.data.number;
+    const double l = to_number(left);
+    const double r = to_number(right);
 
     switch (op) {
         case OP_PLUS: // a + b
@@ -171,6 +233,18 @@ Value apply_operator(Interpreter *interp, Value left, Operator op, Value right)
 Value apply_function(Interpreter *interp, Function func, Value *args, int arg_count) {
     Value result = create_number_value(0);
 
+    // the built-ins work on numbers, STR$ keeps every digit of an integer
+    if (func == FUNC_STR && arg_count == 1 && args[0].type == VALUE_INTEGER) {
+        char int_buffer[NUMBER_TEXT_SIZE];
+        format_integer(args[0].data.integer, int_buffer);
+        return create_string_value(int_buffer);
+    }
+    for (int i = 0; i < arg_count; i++) {
+        if (args[i].type == VALUE_INTEGER) {
+            args[i] = create_number_value((double)args[i].data.integer);
+        }
+    }
+
     switch (func) {
         case FUNC_ABS:
             if (arg_count != 1 || args[0].type != VALUE_NUMBER) {
@@ -245,7 +319,7 @@ Value apply_function(Interpreter *interp, Function func, Value *args, int arg_co
                 print_error(interp, "Invalid string argument");
                 goto cleanup_args;
             }
-            result.data.number = strlen(args[0].data.string);
+            result.data.number = (double)args[0].data.string->length;
             break;
 
         case FUNC_VAL:
@@ -257,7 +331,7 @@ Value apply_function(Interpreter *interp, Function func, Value *args, int arg_co
                 print_error(interp, "Invalid string argument");
                 goto cleanup_args;
             }
-            result.data.number = atof(args[0].data.string);
+            result.data.number = atof(args[0].data.string->data);
             break;
 
         case FUNC_STR:
@@ -265,8 +339,8 @@ Value apply_function(Interpreter *interp, Function func, Value *args, int arg_co
                 print_error(interp, "STR$ requires one numeric argument");
                 goto cleanup_args;
             }
-            char str_buffer[100];
-            snprintf(str_buffer, sizeof(str_buffer), "%.6g", args[0].data.number);
+            char str_buffer[NUMBER_TEXT_SIZE];
+            format_number(args[0].data.number, str_buffer);
             cleanup_value(&result); 
             result = create_string_value(str_buffer);
             break;
@@ -292,11 +366,11 @@ Value apply_function(Interpreter *interp, Function func, Value *args, int arg_co
                 print_error(interp, "ASC requires one string argument");
                 goto cleanup_args;
             }
-            if (!args[0].data.string || strlen(args[0].data.string) == 0) {
+            if (!args[0].data.string || args[0].data.string->length == 0) {
                 print_error(interp, "ASC of empty string");
                 goto cleanup_args;
             }
-            result.data.number = (double)(unsigned char)args[0].data.string[0];
+            result.data.number = (double)(unsigned char)args[0].data.string->data[0];
             break;
 
         default:
@@ -311,250 +385,140 @@ cleanup_args:
     return result;
 }
 
-Value evaluate_expression(Interpreter *interp, Token *tokens, int start, int end) {
+Value apply_unary(Interpreter *interp, Operator op, Value operand) {
     Value result = create_number_value(0);
 
-    if (!tokens || start > end || start < 0) {
-        print_error(interp, "Invalid expression range");
-        return result;
+    if (operand.type == VALUE_INTEGER) {
+        switch (op) {
+            case OP_NOT:
+                return create_integer_value(operand.data.integer == 0);
+            case OP_MINUS:
+                if (operand.data.integer == LLONG_MIN) {
+                    print_error(interp, "Integer overflow");
+                    return result;
+                }
+                return create_integer_value(-operand.data.integer);
+            default:
+                return operand;
+        }
     }
 
-    if (start == end) {
-        const Token *token = &tokens[start];
-        switch (token->type) {
-            case TOKEN_NUMBER:
-                if (token->value.type == VALUE_NUMBER) {
-                    return create_number_value(token->value.data.number);
-                }
+    if (operand.type != VALUE_NUMBER) {
+        switch (op) {
+            case OP_NOT:
+                print_error(interp, "NOT operator requires numeric operand");
                 break;
-            case TOKEN_STRING:
-                if (token->value.type == VALUE_STRING && token->value.data.string) {
-                    return create_string_value(token->value.data.string);
-                }
+            case OP_MINUS:
+                print_error(interp, "Unary minus requires numeric operand");
                 break;
-            case TOKEN_VARIABLE: {
-                if (!token->text) {
-                    print_error(interp, "Invalid variable name");
-                    return result;
-                }
-                Variable *var = get_variable(interp, token->text);
-                if (!var) {
-                    print_error(interp, "Undefined variable");
-                    return result;
-                }
-                if (var->value.type == VALUE_STRING && var->value.data.string) {
-                    return create_string_value(var->value.data.string);
-                } else {
-                    return create_number_value(var->value.data.number);
-                }
-            }
-            case TOKEN_FUNCTION: {
-                Function func = token->function;
-                if (func == FUNC_RND) {
-                    result.data.number = (double)rand() / RAND_MAX;
-                    return result;
-                } else {
-                    print_error(interp, "Function requires parentheses");
-                    return result;
-                }
-            }
             default:
-                print_error(interp, "Invalid expression token");
-                return result;
+                print_error(interp, "Unary plus requires numeric operand");
+                break;
         }
+        cleanup_value(&operand);
+        return result;
     }
 
-    // check for function calls first (before unary operators)
-    if (tokens[start].type == TOKEN_FUNCTION) {
-        Function func = tokens[start].function;
-        Value args[10];
-        int arg_count = 0;
+    switch (op) {
+        case OP_NOT:
+            result.data.number = (operand.data.number == 0) ? 1 : 0;
+            break;
+        case OP_MINUS:
+            result.data.number = -operand.data.number;
+            break;
+        default:
+            result.data.number = operand.data.number;
+            break;
+    }
+    return result;
+}
 
-        if (func == FUNC_RND && start == end) {
-            result.data.number = (double)rand() / RAND_MAX;
-            return result;
+// function arguments or array subscripts, left to right; nothing is left to clean up on failure
+int evaluate_arguments(Interpreter *interp, const Node *node, Value *args) {
+    for (int i = 0; i < node->arg_count; i++) {
+        args[i] = evaluate_node(interp, node->args[i]);
+        if (strlen(interp->error_message) > 0) {
+            for (int j = 0; j <= i; j++) {
+                cleanup_value(&args[j]);
+            }
+            return 0;
         }
+    }
+    return 1;
+}
 
-        // func(args) parsing
-        if (start + 1 <= end && tokens[start + 1].type == TOKEN_DELIMITER &&
-            tokens[start + 1].text && strcmp(tokens[start + 1].text, "(") == 0) {
-            
-            int closing_paren = -1;
-            int paren_level = 0;
-            for (int i = start + 1; i <= end; i++) {
-                if (tokens[i].type == TOKEN_DELIMITER && tokens[i].text) {
-                    if (strcmp(tokens[i].text, "(") == 0) {
-                        paren_level++;
-                    } else if (strcmp(tokens[i].text, ")") == 0) {
-                        paren_level--;
-                        if (paren_level == 0) {
-                            closing_paren = i;
-                            break;
-                        }
-                    }
-                }
-            }
-            
-            if (closing_paren == -1) {
-                print_error(interp, "Missing closing parenthesis in function call");
+static Value evaluate_call(Interpreter *interp, const Node *node) {
+    Value args[MAX_FUNCTION_ARGS];
+    if (!evaluate_arguments(interp, node, args)) {
+        return create_number_value(0);
+    }
+    return apply_function(interp, node->function, args, node->arg_count);
+}
+
+static Value evaluate_element(Interpreter *interp, const Node *node) {
+    Value subscripts[MAX_ARRAY_DIMENSIONS];
+    if (!evaluate_arguments(interp, node, subscripts)) {
+        return create_number_value(0);
+    }
+    return load_element(interp, node->slot, subscripts, node->arg_count);
+}
+
+Value evaluate_node(Interpreter *interp, const Node *node) {
+    Value result = create_number_value(0);
+
+    if (!node) {
+        print_error(interp, "Invalid expression");
+        return result;
+    }
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            return node->value;
+        case NODE_STRING:
+            return retain_value(node->value);
+        case NODE_VARIABLE: {
+            const Variable *var = &interp->variables[node->slot];
+            if (!var->defined) {
+                print_error(interp, "Undefined variable");
                 return result;
             }
-            
-            if (closing_paren > start + 2) {
-                int arg_start = start + 2;
-                paren_level = 0;
-
-                for (int i = arg_start; i < closing_paren; i++) {
-                    if (tokens[i].type == TOKEN_DELIMITER && tokens[i].text) {
-                        if (strcmp(tokens[i].text, "(") == 0) {
-                            paren_level++;
-                        } else if (strcmp(tokens[i].text, ")") == 0) {
-                            paren_level--;
-                        } else if (paren_level == 0 && strcmp(tokens[i].text, ",") == 0) {
-                            if (arg_count < 10) {
-                                args[arg_count] = evaluate_expression(interp, tokens, arg_start, i - 1);
-                                if (strlen(interp->error_message) > 0) {
-                                    for (int j = 0; j < arg_count; j++) {
-                                        cleanup_value(&args[j]);
-                                    }
-                                    cleanup_value(&args[arg_count]);
-                                    return result;
-                                }
-                                arg_count++;
-                            }
-                            arg_start = i + 1;
-                            continue;
-                        }
-                    }
-                }
-                
-                // last arg
-                if (arg_count < 10 && arg_start < closing_paren) {
-                    args[arg_count] = evaluate_expression(interp, tokens, arg_start, closing_paren - 1);
-                    if (strlen(interp->error_message) > 0) {
-                        for (int j = 0; j < arg_count; j++) {
-                            cleanup_value(&args[j]);
-                        }
-                        cleanup_value(&args[arg_count]);
-                        return result;
-                    }
-                    arg_count++;
-                }
-            }
-            
-            return apply_function(interp, func, args, arg_count);
-        } else if (func == FUNC_RND) {
-            result.data.number = (double)rand() / RAND_MAX;
-            return result;
-        } else {
-            print_error(interp, "Function call requires parentheses");
-            return result;
+            return retain_value(var->value);
         }
-    }
-
-    // unary ops
-    if (start < end && tokens[start].type == TOKEN_OPERATOR) {
-        if (tokens[start].operator == OP_NOT) {
-            Value operand = evaluate_expression(interp, tokens, start + 1, end);
+        case NODE_UNARY: {
+            Value operand = evaluate_node(interp, node->left);
             if (strlen(interp->error_message) > 0) {
                 cleanup_value(&operand);
                 return result;
             }
-            if (operand.type == VALUE_NUMBER) {
-                result.data.number = (operand.data.number == 0) ? 1 : 0;
-            } else {
-                print_error(interp, "NOT operator requires numeric operand");
-            }
-            cleanup_value(&operand);
-            return result;
-        } else if (tokens[start].operator == OP_MINUS) {
-            Value operand = evaluate_expression(interp, tokens, start + 1, end);
+            return apply_unary(interp, node->op, operand);
+        }
+        case NODE_BINARY: {
+            Value left = evaluate_node(interp, node->left);
             if (strlen(interp->error_message) > 0) {
-                cleanup_value(&operand);
+                cleanup_value(&left);
                 return result;
             }
-            if (operand.type == VALUE_NUMBER) {
-                result.data.number = -operand.data.number;
-            } else {
-                print_error(interp, "Unary minus requires numeric operand");
-            }
-            cleanup_value(&operand);
-            return result;
-        } else if (tokens[start].operator == OP_PLUS) {
-            Value operand = evaluate_expression(interp, tokens, start + 1, end);
+            Value right = evaluate_node(interp, node->right);
             if (strlen(interp->error_message) > 0) {
-                cleanup_value(&operand);
+                cleanup_value(&left);
+                cleanup_value(&right);
                 return result;
             }
-            if (operand.type == VALUE_NUMBER) {
-                result.data.number = operand.data.number;
-            } else {
-                print_error(interp, "Unary plus requires numeric operand");
-            }
-            cleanup_value(&operand);
-            return result;
-        }
-    }
-
-    int paren_level = 0;
-    int fully_wrapped = 0;
-    if (tokens[start].type == TOKEN_DELIMITER && tokens[start].text && 
-        strcmp(tokens[start].text, "(") == 0) {
-        fully_wrapped = 1;
-        for (int i = start; i <= end; i++) {
-            if (tokens[i].type == TOKEN_DELIMITER && tokens[i].text) {
-                if (strcmp(tokens[i].text, "(") == 0) {
-                    paren_level++;
-                } else if (strcmp(tokens[i].text, ")") == 0) {
-                    paren_level--;
-                    if (paren_level == 0 && i < end) {
-                        fully_wrapped = 0;
-                        break;
-                    }
-                }
-            }
-        }
-        if (fully_wrapped && paren_level == 0) {
-            return evaluate_expression(interp, tokens, start + 1, end - 1);
-        }
-    }
-
-    // look for operator with the lowest precedence (rightmost for left-associative)
-    int op_pos = -1;
-    int min_precedence = 999;
-    paren_level = 0;
-
-    for (int i = start; i <= end; i++) {
-        if (tokens[i].type == TOKEN_DELIMITER && tokens[i].text) {
-            if (strcmp(tokens[i].text, "(") == 0) {
-                paren_level++;
-            } else if (strcmp(tokens[i].text, ")") == 0) {
-                paren_level--;
-            }
-        } else if (paren_level == 0 && tokens[i].type == TOKEN_OPERATOR) {
-            const int precedence = get_precedence(tokens[i].operator);
-            if (precedence > 0 && precedence <= min_precedence) {
-                min_precedence = precedence;
-                op_pos = i;
-            }
+            return apply_operator(interp, left, node->op, right);
         }
-    }
-
-    if (op_pos != -1) {
-        const Value left = evaluate_expression(interp, tokens, start, op_pos - 1);
-        if (strlen(interp->error_message) > 0) {
-            cleanup_value(&left);
-            return result;
+        case NODE_FUNCTION:
+            return evaluate_call(interp, node);
+        case NODE_ARRAY:
+            return evaluate_element(interp, node);
+        case NODE_PARAM:
+            return retain_value(interp->frame[node->slot]);
+        case NODE_FN_CALL: {
+            Value args[MAX_FUNCTION_ARGS];
+            if (!evaluate_arguments(interp, node, args)) return result;
+            return call_function(interp, node->slot, args, node->arg_count);
         }
-        const Value right = evaluate_expression(interp, tokens, op_pos + 1, end);
-        if (strlen(interp->error_message) > 0) {
-            cleanup_value(&left);
-            cleanup_value(&right);
-            return result;
-        }
-        return apply_operator(interp, left, tokens[op_pos].operator, right);
     }
 
     print_error(interp, "Invalid expression");
     return result;
-}
\ No newline at end of file
+}
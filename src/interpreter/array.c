@@ -0,0 +1,207 @@
+#include "interpreter/basic_interpreter.h"
+#include <stdint.h>
+
+// arrays are stored row-major in one block typed by the name: A() packs
+// doubles, A%() long longs and A$() String pointers (NULL reads as "").
+// an element's offset is the dot product of its subscripts and the strides.
+
+static size_t element_size(ValueType type) {
+    switch (type) {
+        case VALUE_INTEGER:
+            return sizeof(long long);
+        case VALUE_STRING:
+            return sizeof(String *);
+        default:
+            return sizeof(double);
+    }
+}
+
+void free_array(Variable *var) {
+    if (var->element_type == VALUE_STRING && var->array_data) {
+        String **strings = var->array_data;
+        for (size_t i = 0; i < var->element_count; i++) {
+            Value element;
+            element.type = VALUE_STRING;
+            element.data.string = strings[i];
+            cleanup_value(&element);
+        }
+    }
+    free(var->array_data);
+    free(var->dim_sizes);
+    free(var->strides);
+    var->is_array = 0;
+    var->dimensions = 0;
+    var->dim_sizes = NULL;
+    var->strides = NULL;
+    var->element_count = 0;
+    var->array_data = NULL;
+}
+
+// replaces var's array with a zeroed one; bounds are the upper subscripts, as in DIM
+int allocate_array(Interpreter *interp, Variable *var, const long long *bounds, int count) {
+    int *dim_sizes = malloc(sizeof(int) * (size_t)count);
+    size_t *strides = malloc(sizeof(size_t) * (size_t)count);
+    if (!dim_sizes || !strides) {
+        free(dim_sizes);
+        free(strides);
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+
+    const ValueType type = var->name[strlen(var->name) - 1] == '$' ? VALUE_STRING :
+                           var->integer ? VALUE_INTEGER : VALUE_NUMBER;
+    const size_t size = element_size(type);
+
+    // the last subscript varies fastest
+    size_t element_count = 1;
+    for (int i = count - 1; i >= 0; i--) {
+        if (bounds[i] < 0 || bounds[i] >= INT_MAX) {
+            free(dim_sizes);
+            free(strides);
+            print_error(interp, "Invalid array dimension");
+            return 0;
+        }
+        dim_sizes[i] = (int)bounds[i] + 1;
+        strides[i] = element_count;
+        if (element_count > SIZE_MAX / size / (size_t)dim_sizes[i]) {
+            free(dim_sizes);
+            free(strides);
+            print_error(interp, "Array too large");
+            return 0;
+        }
+        element_count *= (size_t)dim_sizes[i];
+    }
+
+    // zero bits are 0, 0.0 and the NULL empty string alike
+    void *data = calloc(element_count, size);
+    if (!data) {
+        free(dim_sizes);
+        free(strides);
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+
+    free_array(var);
+    var->is_array = 1;
+    var->dimensions = count;
+    var->dim_sizes = dim_sizes;
+    var->strides = strides;
+    var->element_count = element_count;
+    var->element_type = type;
+    var->array_data = data;
+    return 1;
+}
+
+// DIM A(n, m): consumes the bounds; dimensioning again replaces the array
+int dimension_array(Interpreter *interp, int slot, Value *bounds, int count) {
+    long long upper[MAX_ARRAY_DIMENSIONS];
+    int ok = count > 0 && count <= MAX_ARRAY_DIMENSIONS;
+    if (!ok) print_error(interp, "Invalid array dimension");
+
+    for (int i = 0; i < count; i++) {
+        if (ok) ok = to_integer(interp, bounds[i], &upper[i]);
+        cleanup_value(&bounds[i]);
+    }
+    return ok && allocate_array(interp, &interp->variables[slot], upper, count);
+}
+
+// consumes the subscripts; an array used before DIM gets bounds of 10, as in classic BASIC
+static int element_offset(Interpreter *interp, Variable *var, Value *subscripts, int count, size_t *offset) {
+    long long index[MAX_ARRAY_DIMENSIONS];
+    int ok = count > 0 && count <= MAX_ARRAY_DIMENSIONS;
+    if (!ok) print_error(interp, "Wrong number of subscripts");
+
+    for (int i = 0; i < count; i++) {
+        if (ok) ok = to_integer(interp, subscripts[i], &index[i]);
+        cleanup_value(&subscripts[i]);
+    }
+    if (!ok) return 0;
+
+    if (!var->is_array) {
+        long long bounds[MAX_ARRAY_DIMENSIONS];
+        for (int i = 0; i < count; i++) bounds[i] = DEFAULT_ARRAY_BOUND;
+        if (!allocate_array(interp, var, bounds, count)) return 0;
+    }
+    if (count != var->dimensions) {
+        print_error(interp, "Wrong number of subscripts");
+        return 0;
+    }
+
+    size_t position = 0;
+    for (int i = 0; i < count; i++) {
+        if (index[i] < 0 || index[i] >= var->dim_sizes[i]) {
+            print_error(interp, "Subscript out of range");
+            return 0;
+        }
+        position += (size_t)index[i] * var->strides[i];
+    }
+    *offset = position;
+    return 1;
+}
+
+Value load_element(Interpreter *interp, int slot, Value *subscripts, int count) {
+    Variable *var = &interp->variables[slot];
+    size_t offset;
+    if (!element_offset(interp, var, subscripts, count, &offset)) {
+        return create_number_value(0);
+    }
+
+    switch (var->element_type) {
+        case VALUE_INTEGER:
+            return create_integer_value(((long long *)var->array_data)[offset]);
+        case VALUE_STRING: {
+            String *string = ((String **)var->array_data)[offset];
+            if (!string) return create_string_value("");
+            Value value;
+            value.type = VALUE_STRING;
+            value.data.string = string;
+            return retain_value(value);
+        }
+        default:
+            return create_number_value(((double *)var->array_data)[offset]);
+    }
+}
+
+// consumes the subscripts and the value, which converts like a scalar assignment
+int store_element(Interpreter *interp, int slot, Value *subscripts, int count, Value value) {
+    Variable *var = &interp->variables[slot];
+    size_t offset;
+    if (!element_offset(interp, var, subscripts, count, &offset)) {
+        cleanup_value(&value);
+        return 0;
+    }
+
+    switch (var->element_type) {
+        case VALUE_INTEGER: {
+            long long integer;
+            const int converted = to_integer(interp, value, &integer);
+            cleanup_value(&value);
+            if (!converted) return 0;
+            ((long long *)var->array_data)[offset] = integer;
+            return 1;
+        }
+        case VALUE_STRING: {
+            if (value.type != VALUE_STRING || !value.data.string) {
+                cleanup_value(&value);
+                print_error(interp, "Type mismatch");
+                return 0;
+            }
+            // the element takes over the value's reference
+            String **element = &((String **)var->array_data)[offset];
+            Value previous;
+            previous.type = VALUE_STRING;
+            previous.data.string = *element;
+            cleanup_value(&previous);
+            *element = value.data.string;
+            return 1;
+        }
+        default:
+            if (value.type == VALUE_STRING) {
+                cleanup_value(&value);
+                print_error(interp, "Type mismatch");
+                return 0;
+            }
+            ((double *)var->array_data)[offset] = to_number(value);
+            return 1;
+    }
+}
@@ -1,200 +1,140 @@
 #include "basic_interpreter.h"
 
-// lookup tables
-typedef struct cl_t {
-    const char *name;
-    Command cmd;
-} CommandLookup;
-
 typedef struct ol_t {
     const char *name;
     Operator op;
 } OperatorLookup;
 
-typedef struct fl_t {
-    const char *name;
-    Function func;
-} FunctionLookup;
-
-static const CommandLookup command_table[] = {
-    {"PRINT", CMD_PRINT},
-    {"LET", CMD_LET},
-    {"INPUT", CMD_INPUT},
-    {"IF", CMD_IF},
-    {"THEN", CMD_THEN},
-    {"ELSE", CMD_ELSE},
-    {"GOTO", CMD_GOTO},
-    {"GOSUB", CMD_GOSUB},
-    {"RETURN", CMD_RETURN},
-    {"FOR", CMD_FOR},
-    {"TO", CMD_TO},
-    {"STEP", CMD_STEP},
-    {"NEXT", CMD_NEXT},
-    {"END", CMD_END},
-    {"REM", CMD_REM},
-    {"DATA", CMD_DATA},
-    {"READ", CMD_READ},
-    {"RESTORE", CMD_RESTORE},
-    {"DIM", CMD_DIM},
-    {"DEF", CMD_DEF},
-    {"ON", CMD_ON},
-    {"STOP", CMD_STOP},
-    {"RUN", CMD_RUN},
-    {"LIST", CMD_LIST},
-    {"NEW", CMD_NEW},
-    {"CLEAR", CMD_CLEAR},
-    {NULL, CMD_UNKNOWN}
-};
-
+// symbolic operators, the word operators are keywords (see tokenizer/keywords.c)
 static const OperatorLookup operator_table[] = {
     {"+", OP_PLUS},
     {"-", OP_MINUS},
     {"*", OP_MULTIPLY},
     {"/", OP_DIVIDE},
+    {"\\", OP_INT_DIVIDE},
     {"^", OP_POWER},
-    {"MOD", OP_MOD},
     {"=", OP_EQUAL},
     {"<>", OP_NOT_EQUAL},
     {"<", OP_LESS},
     {"<=", OP_LESS_EQUAL},
     {">", OP_GREATER},
     {">=", OP_GREATER_EQUAL},
-    {"AND", OP_AND},
-    {"OR", OP_OR},
-    {"NOT", OP_NOT},
     {NULL, OP_UNKNOWN}
 };
 
-static const FunctionLookup function_table[] = {
-    {"ABS", FUNC_ABS},
-    {"SIN", FUNC_SIN},
-    {"COS", FUNC_COS},
-    {"TAN", FUNC_TAN},
-    {"SQR", FUNC_SQR},
-    {"INT", FUNC_INT},
-    {"RND", FUNC_RND},
-    {"LEN", FUNC_LEN},
-    {"LEFT$", FUNC_LEFT},
-    {"RIGHT$", FUNC_RIGHT},
-    {"MID$", FUNC_MID},
-    {"VAL", FUNC_VAL},
-    {"STR$", FUNC_STR},
-    {"CHR$", FUNC_CHR},
-    {"ASC", FUNC_ASC},
-    {NULL, FUNC_UNKNOWN}
-};
-
-char* process_escape_sequences(const char* input) {
-    if (!input) return NULL;
-    
-    size_t len = strlen(input);
-    char* result = malloc(len + 1);
-    if (!result) return NULL;
-    
-    const char* src = input;
-    char* dst = result;
-    
-    while (*src) {
-        if (*src == '\\' && *(src + 1)) {
-            switch (*(src + 1)) {
-                case 'n':
-                    *dst++ = '\n';
-                    src += 2;
-                    break;
-                case 't':
-                    *dst++ = '\t';
-                    src += 2;
-                    break;
-                case 'r':
-                    *dst++ = '\r';
-                    src += 2;
-                    break;
-                case '\\':
-                    *dst++ = '\\';
-                    src += 2;
-                    break;
-                case '"':
-                    *dst++ = '"';
-                    src += 2;
-                    break;
-                case '\'':
-                    *dst++ = '\'';
-                    src += 2;
-                    break;
-                default:
-                    *dst++ = *src++;
-                    break;
-            }
-        } else {
-            *dst++ = *src++;
-        }
-    }
-    *dst = '\0';
-    
-    return result;
-}
-
 void init_interpreter(Interpreter *interp) {
     if (!interp) return;
     
+    interp->lines = NULL;
     interp->line_count = 0;
+    interp->line_capacity = 0;
+    interp->gap_start = 0;
+    interp->gap_end = 0;
+    interp->variables = NULL;
     interp->variable_count = 0;
+    interp->variable_capacity = 0;
+    interp->variable_hash = NULL;
+    interp->variable_hash_size = 0;
     interp->current_line = 0;
     interp->running = 0;
+    interp->for_stack = NULL;
     interp->for_stack_top = -1;
+    interp->for_stack_capacity = 0;
+    interp->gosub_stack = NULL;
     interp->gosub_stack_top = -1;
+    interp->gosub_stack_capacity = 0;
+    interp->data_values = NULL;
     interp->data_count = 0;
+    interp->data_capacity = 0;
     interp->data_pointer = 0;
+    interp->functions = NULL;
+    interp->function_count = 0;
+    interp->function_capacity = 0;
+    interp->frame = NULL;
+    interp->call_depth = 0;
+    interp->output.data = NULL;
+    interp->output.length = 0;
+    interp->output.capacity = 0;
+    interp->output.policy = FLUSH_LINE;
+    interp->profiling = 0;
+    interp->profile = NULL;
+    interp->sample_interval = 0;
+    interp->samples = NULL;
     strcpy(interp->error_message, "");
+    interp->quiet_errors = 0;
+    interp->resolved = 0;
+    arena_init(&interp->arena);
+    interp->use_vm = 0;
+    interp->bytecode = NULL;
+    interp->image.data = NULL;
+    interp->image.size = 0;
+    interp->image.mapped = 0;
+}
+
+Interpreter *create_interpreter(void) {
+    Interpreter *interp = malloc(sizeof(Interpreter));
+    if (!interp) return NULL;
+
+    init_interpreter(interp);
+    return interp;
 }
 
 void cleanup_interpreter(Interpreter *interp) {
     if (!interp) return;
-    
-    for (int i = 0; i < interp->line_count; i++) {
-        if (interp->lines[i].text) {
-            free(interp->lines[i].text);
-            interp->lines[i].text = NULL;
-        }
-        if (interp->lines[i].tokens) {
-            for (int j = 0; j < interp->lines[i].token_count; j++) {
-                if (interp->lines[i].tokens[j].text) {
-                    free(interp->lines[i].tokens[j].text);
-                    interp->lines[i].tokens[j].text = NULL;
-                }
-                cleanup_value(&interp->lines[i].tokens[j].value);
-            }
-            free(interp->lines[i].tokens);
-            interp->lines[i].tokens = NULL;
-        }
-        interp->lines[i].token_count = 0;
-    }
+
+    invalidate_bytecode(interp);
+    // image bytecode and line text point into the mapping
+    unmap_file(&interp->image);
+
+    // line text, tokens and statement trees all live in the arena
+    arena_reset(&interp->arena);
 
     for (int i = 0; i < interp->variable_count; i++) {
         cleanup_value(&interp->variables[i].value);
-        if (interp->variables[i].is_array && interp->variables[i].array_data) {
-            for (int j = 0; j < interp->variables[i].dimensions; j++) {
-                cleanup_value(&interp->variables[i].array_data[j]);
-            }
-            free(interp->variables[i].array_data);
-            interp->variables[i].array_data = NULL;
-            if (interp->variables[i].dim_sizes) {
-                free(interp->variables[i].dim_sizes);
-                interp->variables[i].dim_sizes = NULL;
-            }
-        }
+        free_array(&interp->variables[i]);
     }
 
-    for (int i = 0; i < interp->data_count; i++) {
-        if (interp->data_values[i]) {
-            free(interp->data_values[i]);
-            interp->data_values[i] = NULL;
-        }
-    }
-    
+    // DATA strings live in the arena, the pool keeps its capacity
+    // storage keeps its capacity for the next program
     interp->line_count = 0;
+    interp->gap_start = 0;
+    interp->gap_end = interp->line_capacity;
     interp->variable_count = 0;
+    if (interp->variable_hash) {
+        memset(interp->variable_hash, 0, sizeof(int) * interp->variable_hash_size);
+    }
     interp->data_count = 0;
+    interp->function_count = 0;
+    interp->resolved = 0;
+}
+
+void destroy_interpreter(Interpreter *interp) {
+    if (!interp) return;
+
+    flush_output(interp);
+    cleanup_interpreter(interp);
+    arena_free(&interp->arena);
+    free(interp->lines);
+    free(interp->variables);
+    free(interp->variable_hash);
+    free(interp->for_stack);
+    free(interp->gosub_stack);
+    free(interp->data_values);
+    free(interp->functions);
+    free(interp->output.data);
+    free_profile(interp->profile);
+    free_samples(interp->samples);
+    free(interp);
+}
+
+// doubles the capacity, the caller keeps the old array if this fails
+void *grow_array(void *array, int *capacity, size_t item_size) {
+    const int grown = *capacity > 0 ? *capacity * 2 : 16;
+    void *resized = realloc(array, item_size * (size_t)grown);
+    if (!resized) return NULL;
+
+    *capacity = grown;
+    return resized;
 }
 
 Value create_number_value(double number) {
@@ -204,33 +144,116 @@ Value create_number_value(double number) {
     return val;
 }
 
-Value create_string_value(const char *string) {
+Value create_integer_value(long long integer) {
     Value val;
-    val.type = VALUE_STRING;
-    if (string && strlen(string) > 0) {
-        char* processed = process_escape_sequences(string);
-        if (processed) {
-            val.data.string = processed;
-        } else {
-            val.data.string = malloc(strlen(string) + 1);
-            if (val.data.string) {
-                strcpy(val.data.string, string);
-            }
-        }
+    val.type = VALUE_INTEGER;
+    val.data.integer = integer;
+    return val;
+}
+
+// A% names hold 64-bit integers
+int is_integer_name(const char *name) {
+    const size_t length = strlen(name);
+    return length > 0 && name[length - 1] == '%';
+}
+
+double to_number(Value value) {
+    return value.type == VALUE_INTEGER ? (double)value.data.integer : value.data.number;
+}
+
+// rounds to the nearest integer, the way an assignment to an A% variable does
+int to_integer(Interpreter *interp, Value value, long long *integer) {
+    if (value.type == VALUE_INTEGER) {
+        *integer = value.data.integer;
+        return 1;
+    }
+    if (value.type != VALUE_NUMBER) {
+        print_error(interp, "Type mismatch");
+        return 0;
+    }
+
+    const double rounded = round(value.data.number);
+    if (!(rounded >= (double)LLONG_MIN && rounded < -(double)LLONG_MIN)) {
+        print_error(interp, "Integer overflow");
+        return 0;
+    }
+    *integer = (long long)rounded;
+    return 1;
+}
+
+String *create_string(const char *text, size_t length) {
+    String *string = malloc(sizeof(String) + length + 1);
+    if (!string) return NULL;
+
+    string->refcount = 1;
+    string->length = length;
+    string->capacity = length;
+    if (length > 0) {
+        memcpy(string->data, text, length);
+    }
+    string->data[length] = '\0';
+    return string;
+}
+
+// takes over the caller's reference, unshared strings grow geometrically in place
+String *append_string(String *string, const char *text, size_t length) {
+    const size_t needed = string->length + length;
+
+    if (string->refcount == 1 && needed <= string->capacity) {
+        memcpy(string->data + string->length, text, length);
+        string->length = needed;
+        string->data[needed] = '\0';
+        return string;
+    }
+
+    size_t capacity = string->capacity * 2;
+    if (capacity < needed) capacity = needed;
+    if (capacity < 16) capacity = 16;
+
+    String *grown;
+    if (string->refcount == 1) {
+        grown = realloc(string, sizeof(String) + capacity + 1);
+        if (!grown) return NULL;
     } else {
-        val.data.string = malloc(1);
-        if (val.data.string) {
-            val.data.string[0] = '\0';
-        }
+        // shared or immortal: copy, the other holders keep the original
+        grown = malloc(sizeof(String) + capacity + 1);
+        if (!grown) return NULL;
+        grown->refcount = 1;
+        grown->length = string->length;
+        memcpy(grown->data, string->data, string->length);
+        if (string->refcount > 0) string->refcount--;
     }
+    grown->capacity = capacity;
+    memcpy(grown->data + grown->length, text, length);
+    grown->length = needed;
+    grown->data[needed] = '\0';
+    return grown;
+}
+
+// escapes are processed once by the tokenizer, runtime strings are taken verbatim
+Value create_string_value(const char *string) {
+    Value val;
+    val.type = VALUE_STRING;
+    val.data.string = create_string(string ? string : "", string ? strlen(string) : 0);
     return val;
 }
 
+// shares the string instead of copying it
+Value retain_value(Value value) {
+    if (value.type == VALUE_STRING && value.data.string && value.data.string->refcount > 0) {
+        value.data.string->refcount++;
+    }
+    return value;
+}
+
 void cleanup_value(Value *value) {
     if (!value) return;
     
     if (value->type == VALUE_STRING && value->data.string) {
-        free(value->data.string);
+        String *string = value->data.string;
+        if (string->refcount > 0 && --string->refcount == 0) {
+            free(string);
+        }
         value->data.string = NULL;
     }
     value->type = VALUE_NUMBER;
@@ -239,20 +262,20 @@ void cleanup_value(Value *value) {
 
 Command get_command(const char *text) {
     if (!text) return CMD_UNKNOWN;
-    
-    for (int i = 0; command_table[i].name != NULL; i++) {
-        if (strcasecmp(text, command_table[i].name) == 0) {
-            return command_table[i].cmd;
-        }
-    }
-    return CMD_UNKNOWN;
+
+    const Keyword *keyword = find_keyword(text, strlen(text));
+    return keyword && keyword->type == TOKEN_COMMAND ? (Command)keyword->value : CMD_UNKNOWN;
 }
 
 Operator get_operator(const char *text) {
     if (!text) return OP_UNKNOWN;
-    
+
+    const Keyword *keyword = find_keyword(text, strlen(text));
+    if (keyword) {
+        return keyword->type == TOKEN_OPERATOR ? (Operator)keyword->value : OP_UNKNOWN;
+    }
     for (int i = 0; operator_table[i].name != NULL; i++) {
-        if (strcasecmp(text, operator_table[i].name) == 0) {
+        if (strcmp(text, operator_table[i].name) == 0) {
             return operator_table[i].op;
         }
     }
@@ -261,57 +284,227 @@ Operator get_operator(const char *text) {
 
 Function get_function(const char *text) {
     if (!text) return FUNC_UNKNOWN;
-    
-    for (int i = 0; function_table[i].name != NULL; i++) {
-        if (strcasecmp(text, function_table[i].name) == 0) {
-            return function_table[i].func;
-        }
+
+    const Keyword *keyword = find_keyword(text, strlen(text));
+    return keyword && keyword->type == TOKEN_FUNCTION ? (Function)keyword->value : FUNC_UNKNOWN;
+}
+
+// case-insensitive FNV-1a, variable names compare with strcasecmp
+static unsigned int hash_name(const char *name) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *ptr = (const unsigned char *)name; *ptr; ptr++) {
+        hash ^= (unsigned int)toupper(*ptr);
+        hash *= 16777619u;
     }
-    return FUNC_UNKNOWN;
+    return hash;
 }
 
-Variable *get_variable(Interpreter *interp, const char *name) {
-    if (!interp || !name) return NULL;
-    
-    for (int i = 0; i < interp->variable_count; i++) {
-        if (strcasecmp(interp->variables[i].name, name) == 0) {
-            return &interp->variables[i];
+int find_variable_slot(Interpreter *interp, const char *name) {
+    if (!interp || !name || interp->variable_hash_size == 0) return -1;
+
+    const unsigned int mask = (unsigned int)interp->variable_hash_size - 1;
+    unsigned int index = hash_name(name) & mask;
+    while (interp->variable_hash[index] != 0) {
+        const int slot = interp->variable_hash[index] - 1;
+        if (strcasecmp(interp->variables[slot].name, name) == 0) {
+            return slot;
         }
+        index = (index + 1) & mask;
     }
-    return NULL;
+    return -1;
 }
 
-Variable *create_variable(Interpreter *interp, const char *name) {
-    if (!interp || !name) return NULL;
-    
-    if (interp->variable_count >= MAX_VARIABLES) {
-        print_error(interp, "Too many variables");
-        return NULL;
+static void insert_variable_hash(Interpreter *interp, int slot) {
+    const unsigned int mask = (unsigned int)interp->variable_hash_size - 1;
+    unsigned int index = hash_name(interp->variables[slot].name) & mask;
+    while (interp->variable_hash[index] != 0) {
+        index = (index + 1) & mask;
+    }
+    interp->variable_hash[index] = slot + 1;
+}
+
+// keeps the table at most half full
+static int grow_variable_hash(Interpreter *interp) {
+    const int size = interp->variable_hash_size > 0 ? interp->variable_hash_size * 2 : INITIAL_VARIABLE_HASH_SIZE;
+    int *hash = calloc((size_t)size, sizeof(int));
+    if (!hash) return 0;
+
+    free(interp->variable_hash);
+    interp->variable_hash = hash;
+    interp->variable_hash_size = size;
+    for (int slot = 0; slot < interp->variable_count; slot++) {
+        insert_variable_hash(interp, slot);
+    }
+    return 1;
+}
+
+int resolve_variable(Interpreter *interp, const char *name) {
+    if (!interp || !name) return -1;
+
+    const int existing = find_variable_slot(interp, name);
+    if (existing != -1) return existing;
+
+    if (interp->variable_count >= interp->variable_capacity) {
+        Variable *variables = grow_array(interp->variables, &interp->variable_capacity, sizeof(Variable));
+        if (!variables) return -1;
+        interp->variables = variables;
+    }
+    if ((interp->variable_count + 1) * 2 > interp->variable_hash_size && !grow_variable_hash(interp)) {
+        return -1;
     }
 
-    Variable *var = &interp->variables[interp->variable_count++];
+    // the slot exists from now on but reads fail until it is assigned
+    const int slot = interp->variable_count++;
+    Variable *var = &interp->variables[slot];
     strncpy(var->name, name, sizeof(var->name) - 1);
     var->name[sizeof(var->name) - 1] = '\0';
-    var->value = create_number_value(0);
+    var->defined = 0;
+    var->integer = is_integer_name(var->name);
+    var->value = var->integer ? create_integer_value(0) : create_number_value(0);
     var->is_array = 0;
     var->dimensions = 0;
     var->dim_sizes = NULL;
+    var->strides = NULL;
+    var->element_count = 0;
+    var->element_type = VALUE_NUMBER;
     var->array_data = NULL;
+    insert_variable_hash(interp, slot);
+
+    return slot;
+}
 
+Variable *get_variable(Interpreter *interp, const char *name) {
+    const int slot = find_variable_slot(interp, name);
+    if (slot == -1 || !interp->variables[slot].defined) {
+        return NULL;
+    }
+    return &interp->variables[slot];
+}
+
+Variable *create_variable(Interpreter *interp, const char *name) {
+    if (!interp || !name) return NULL;
+
+    const int slot = resolve_variable(interp, name);
+    if (slot == -1) {
+        print_error(interp, "Out of memory");
+        return NULL;
+    }
+
+    Variable *var = &interp->variables[slot];
+    var->defined = 1;
     return var;
 }
 
-void set_variable(Interpreter *interp, const char *name, Value value) {
-    if (!interp || !name) return;
-    
-    Variable *var = get_variable(interp, name);
-    if (!var) {
-        var = create_variable(interp, name);
-        if (!var) return;
+// integers only live in A% names, anything else holds them as numbers; a value
+// that cannot convert is consumed and left as 0
+int coerce_value(Interpreter *interp, int integer, Value *value) {
+    if (integer == (value->type == VALUE_INTEGER)) return 1;
+
+    if (integer) {
+        long long converted;
+        const int ok = to_integer(interp, *value, &converted);
+        cleanup_value(value);
+        *value = ok ? create_integer_value(converted) : create_number_value(0);
+        return ok;
     }
+    *value = create_number_value((double)value->data.integer);
+    return 1;
+}
 
+int set_variable_slot(Interpreter *interp, int slot, Value value) {
+    Variable *var = &interp->variables[slot];
+    if (!coerce_value(interp, var->integer, &value)) return 0;
     cleanup_value(&var->value);
     var->value = value;
+    var->defined = 1;
+    return 1;
+}
+
+// LET A$ = A$ + ...: consumes the operands, appending in place when A$ holds the only reference
+int append_to_variable(Interpreter *interp, int slot, Value *operands, int count) {
+    Variable *var = &interp->variables[slot];
+    if (!var->defined) {
+        for (int i = 0; i < count; i++) cleanup_value(&operands[i]);
+        print_error(interp, "Undefined variable");
+        return 0;
+    }
+
+    int all_strings = var->value.type == VALUE_STRING && var->value.data.string;
+    for (int i = 0; i < count && all_strings; i++) {
+        all_strings = operands[i].type == VALUE_STRING && operands[i].data.string;
+    }
+
+    if (!all_strings) {
+        // same result and errors as evaluating the + chain
+        Value result = retain_value(var->value);
+        for (int i = 0; i < count; i++) {
+            if (strlen(interp->error_message) > 0) {
+                cleanup_value(&operands[i]);
+                continue;
+            }
+            result = apply_operator(interp, result, OP_PLUS, operands[i]);
+        }
+        if (strlen(interp->error_message) > 0) {
+            cleanup_value(&result);
+            return 0;
+        }
+        return set_variable_slot(interp, slot, result);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const String *operand = operands[i].data.string;
+        String *appended = append_string(var->value.data.string, operand->data, operand->length);
+        if (!appended) {
+            for (int j = i; j < count; j++) cleanup_value(&operands[j]);
+            print_error(interp, "Memory allocation failed");
+            return 0;
+        }
+        var->value.data.string = appended;
+        cleanup_value(&operands[i]);
+    }
+    return 1;
+}
+
+// a literal from arena becomes a counted copy; NULL when out of memory
+static String *keep_string(const Arena *arena, String *string) {
+    if (!string || string->refcount != STRING_IMMORTAL || !arena_owns(arena, string)) return string;
+    return create_string(string->data, string->length);
+}
+
+// immediate statements are parsed into a scratch arena that is reset after
+// each one, so literals they left in variables are copied out first
+int keep_strings(Interpreter *interp, const Arena *arena) {
+    int ok = 1;
+    for (int i = 0; i < interp->variable_count; i++) {
+        Variable *var = &interp->variables[i];
+        if (var->value.type == VALUE_STRING && var->value.data.string) {
+            var->value.data.string = keep_string(arena, var->value.data.string);
+            if (!var->value.data.string) ok = 0;
+        }
+        if (var->is_array && var->element_type == VALUE_STRING) {
+            String **strings = var->array_data;
+            for (size_t j = 0; j < var->element_count; j++) {
+                if (!strings[j]) continue;
+                strings[j] = keep_string(arena, strings[j]);
+                if (!strings[j]) ok = 0;
+            }
+        }
+    }
+    if (!ok) print_error(interp, "Out of memory");
+    return ok;
+}
+
+void set_variable(Interpreter *interp, const char *name, Value value) {
+    if (!interp || !name) return;
+
+    const int slot = resolve_variable(interp, name);
+    if (slot == -1) {
+        print_error(interp, "Out of memory");
+        cleanup_value(&value);
+        return;
+    }
+
+    set_variable_slot(interp, slot, value);
 }
 
 void print_error(Interpreter *interp, const char *message) {
@@ -319,18 +512,41 @@ void print_error(Interpreter *interp, const char *message) {
     
     snprintf(interp->error_message, sizeof(interp->error_message),
              "Error at line %d: %s",
-             interp->current_line > 0 ? interp->lines[interp->current_line - 1].line_number : 0,
+             interp->running && interp->current_line < interp->line_count ?
+                 interp->lines[interp->current_line].line_number : 0,
              message);
-    printf("%s\n", interp->error_message);
+    if (!interp->quiet_errors) {
+        flush_output(interp);
+        printf("%s\n", interp->error_message);
+    }
 }
 
-int find_line_by_number(Interpreter *interp, int line_number) {
-    if (!interp) return -1;
-    
-    for (int i = 0; i < interp->line_count; i++) {
-        if (interp->lines[i].line_number == line_number) {
-            return i;
+static void resolve_statement(Interpreter *interp, Statement *stmt) {
+    for (; stmt; stmt = stmt->then_statement) {
+        if (stmt->target_line >= 0) {
+            stmt->target_index = find_line_by_number(interp, stmt->target_line);
+        }
+        for (int i = 0; i < stmt->target_count; i++) {
+            stmt->target_indices[i] = find_line_by_number(interp, stmt->target_lines[i]);
         }
     }
-    return -1;
+}
+
+void resolve_program(Interpreter *interp) {
+    if (!interp || interp->resolved) return;
+
+    // execution indexes lines[] directly
+    compact_lines(interp);
+    for (int i = 0; i < interp->line_count; i++) {
+        resolve_statement(interp, interp->lines[i].statement);
+    }
+    build_data_pool(interp);
+    interp->resolved = 1;
+}
+
+void invalidate_program(Interpreter *interp) {
+    if (!interp) return;
+
+    interp->resolved = 0;
+    invalidate_bytecode(interp);
 }
\ No newline at end of file
@@ -6,14 +6,33 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
 
-#define MAX_LINE_LENGTH 512
-#define MAX_VARIABLES 1000
-#define MAX_LINES 10000
-#define MAX_GOTO_STACK 100
-#define MAX_FOR_STACK 100
-#define MAX_GOSUB_STACK 100
-#define MAX_INPUT_LENGTH 256
+// FOR bounds up to this magnitude count exactly in both long long and double
+#define MAX_INTEGRAL_FOR 4503599627370496.0 // 2^52
+#define MAX_STACK_DEPTH 1000000 // guards runaway GOSUB recursion, the stacks themselves grow
+#define MAX_FUNCTION_ARGS 10
+#define MAX_FUNCTION_DEPTH 1000 // DEF FN bodies cannot branch, so any recursion is runaway
+#define MAX_ARRAY_DIMENSIONS 8
+#define DEFAULT_ARRAY_BOUND 10 // arrays used without DIM hold 0..10 in each dimension
+#define MAX_APPEND_OPERANDS 16
+#define INITIAL_VARIABLE_HASH_SIZE 64
+#define OUTPUT_BUFFER_SIZE 65536 // PRINT text held back by a block flush
+#define NUMBER_TEXT_SIZE 32 // longest number text plus the terminator
+#define INPUT_BUFFER_SIZE 65536 // stdin is read in blocks of this size
+#define SAMPLE_INTERVAL 1000 // default microseconds of CPU time between --sample samples
+
+typedef struct arena_chunk_t {
+    struct arena_chunk_t *next;
+    size_t used;
+    size_t size;
+    _Alignas(8) char data[];
+} ArenaChunk;
+
+typedef struct arena_t {
+    ArenaChunk *head;
+    ArenaChunk *current;
+} Arena;
 
 typedef enum token_type_t {
     TOKEN_NUMBER,
@@ -47,6 +66,7 @@ typedef enum command_t {
     CMD_READ,
     CMD_RESTORE,
     CMD_DIM,
+    CMD_MAT,
     CMD_DEF,
     CMD_ON,
     CMD_STOP,
@@ -62,6 +82,7 @@ typedef enum operator_t {
     OP_MINUS,
     OP_MULTIPLY,
     OP_DIVIDE,
+    OP_INT_DIVIDE,
     OP_POWER,
     OP_MOD,
     OP_EQUAL,
@@ -96,26 +117,50 @@ typedef enum function_t {
     FUNC_UNKNOWN
 } Function;
 
+// commands, word operators and functions share one keyword table
+typedef struct keyword_t {
+    const char *name;
+    TokenType type;
+    int value; // Command, Operator or Function depending on type
+} Keyword;
+
 typedef enum value_type_t {
     VALUE_NUMBER,
-    VALUE_STRING
+    VALUE_STRING,
+    VALUE_INTEGER // only A% variables store these, other variables keep a number
 } ValueType;
 
+// immutable, shared by every value holding it and freed with the last reference
+typedef struct string_t {
+    int refcount; // STRING_IMMORTAL for literals owned by an arena
+    size_t length;
+    size_t capacity; // spare room lets an unshared string be appended in place
+    char data[];
+} String;
+
+#define STRING_IMMORTAL -1
+
 typedef struct value_t {
     ValueType type;
     union data_u {
         double number;
-        char *string;
+        String *string;
+        long long integer;
     } data;
 } Value;
 
 typedef struct variable_t {
     char name[32];
+    int defined;
     Value value;
-    int is_array;
+    int integer; // A%: assignments round to a 64-bit integer
+    int is_array; // A() lives beside the scalar A, in the same slot
     int dimensions;
-    int *dim_sizes;
-    Value *array_data;
+    int *dim_sizes; // elements along each dimension, DIM A(10) has 11
+    size_t *strides; // row-major: elements skipped by one step along each dimension
+    size_t element_count;
+    ValueType element_type; // by name: A() doubles, A%() long longs, A$() String pointers
+    void *array_data;
 } Variable;
 
 typedef struct token_t {
@@ -127,64 +172,336 @@ typedef struct token_t {
     Function function;
 } Token;
 
+typedef enum node_type_t {
+    NODE_NUMBER,
+    NODE_STRING,
+    NODE_VARIABLE,
+    NODE_UNARY,
+    NODE_BINARY,
+    NODE_FUNCTION,
+    NODE_ARRAY, // A(i, j): slot plus the subscripts in args
+    NODE_PARAM, // a DEF FN parameter: slot is its position in the call frame
+    NODE_FN_CALL // FNA(x, y): slot indexes interp->functions, the arguments in args
+} NodeType;
+
+typedef struct node_t {
+    NodeType type;
+    Value value;
+    char *name;
+    int slot;
+    Operator op;
+    Function function;
+    struct node_t *left;
+    struct node_t *right;
+    struct node_t **args;
+    int arg_count;
+} Node;
+
+// the forms of MAT target = ..., all on A() arrays of doubles
+typedef enum mat_op_t {
+    MAT_COPY, // MAT A = B
+    MAT_ADD, // MAT C = A + B
+    MAT_SUBTRACT, // MAT C = A - B
+    MAT_MULTIPLY, // MAT C = A * B, the matrix product
+    MAT_SCALE, // MAT C = (k) * A
+    MAT_ZER, // MAT A = ZER [(n, m)]
+    MAT_CON, // MAT A = CON [(n, m)], all ones
+    MAT_IDN, // MAT A = IDN [(n, n)]
+    MAT_TRN // MAT A = TRN(B)
+} MatOp;
+
+typedef struct print_item_t {
+    Node *expr;
+    char separator;
+} PrintItem;
+
+typedef struct statement_t {
+    Command command;
+    const char *error;
+    Node *target;
+    Node *expr;
+    Node *end_expr;
+    Node *step_expr;
+    PrintItem *items;
+    int item_count;
+    char *prompt;
+    Node **operands; // LET A$ = A$ + x + y: the appended operands x, y; DIM: the arrays; MAT: the source arrays; READ, INPUT: the targets
+    int operand_count;
+    MatOp mat_op;
+    int target_line;
+    int target_index;
+    int *target_lines;   // ON n GOTO/GOSUB: the jump table, one line number per n
+    int *target_indices; // and the lines[] index of each, resolved with the program
+    int target_count;
+    Command on_command;  // ON n: CMD_GOTO or CMD_GOSUB
+    struct statement_t *then_statement;
+} Statement;
+
+// DEF FNA(X) = body: bound when its DEF statement runs, so redefining replaces it
+typedef struct user_function_t {
+    char name[32];
+    const Statement *definition; // the DEF statement, NULL until one runs
+} UserFunction;
+
 typedef struct line_t {
     int line_number;
     char *text;
     Token *tokens;
     int token_count;
+    Statement *statement;
+    int data_index; // first DATA item at or after this line, set when the program is resolved
 } Line;
 
+typedef enum bytecode_op_t {
+    BC_LINE,
+    BC_CONST,
+    BC_LOAD_VAR,
+    BC_STORE_VAR,
+    BC_APPEND_VAR,
+    BC_UNARY,
+    BC_BINARY,
+    BC_CALL,
+    BC_PRINT,
+    BC_PRINT_TAB,
+    BC_INPUT,
+    BC_JUMP_IF_FALSE,
+    BC_GOTO,
+    BC_GOSUB,
+    BC_RETURN,
+    BC_FOR,
+    BC_NEXT,
+    BC_END,
+    BC_ERROR,
+    BC_DIM,
+    BC_LOAD_ELEMENT,
+    BC_STORE_ELEMENT,
+    BC_INPUT_ELEMENT,
+    BC_MAT,
+    BC_READ,
+    BC_READ_ELEMENT,
+    BC_RESTORE,
+    BC_DEF,
+    BC_CALL_FN,
+    BC_RETURN_FN,
+    BC_LOAD_PARAM,
+    BC_PICK,
+    BC_DROP_UNDER,
+    BC_CHECK_FN,
+    BC_COERCE,
+    BC_ON_GOTO,
+    BC_ON_GOSUB
+} BytecodeOp;
+
+typedef struct bytecode_t {
+    int *code;
+    int code_count;
+    int code_capacity;
+    Value *constants;
+    int constant_count;
+    int constant_capacity;
+    const char **symbols;
+    int symbol_count;
+    int symbol_capacity;
+    int *line_offsets;
+    int line_count;
+    int max_stack;
+    int function_count; // DEF FN bodies follow the program code, see vm/compiler.c
+    const Statement **definitions; // the DEF statement of each body, NULL in a program image
+    int borrowed; // code and line_offsets point into a mapped program image
+} Bytecode;
+
+typedef struct mapped_file_t {
+    const char *data;
+    size_t size;
+    int mapped;
+} MappedFile;
+
+typedef enum {
+    FLUSH_AUTO,  // line on a terminal, block otherwise
+    FLUSH_LINE,  // after every newline
+    FLUSH_BLOCK, // when the buffer fills
+    FLUSH_EXIT   // when the program ends, the buffer grows to hold everything
+} FlushPolicy;
+
+typedef struct output_t {
+    char *data;
+    size_t length;
+    size_t capacity;
+    FlushPolicy policy;
+} OutputBuffer;
+
+typedef struct profile_t Profile; // see interpreter/profile.c
+typedef struct sampler_t Sampler; // see interpreter/sampler.c
+
 typedef struct for_stack_t {
-    char variable[32];
+    int slot; // the variables array moves when it grows, so the slot is the stable reference
     double start;
     double end;
     double step;
-    int line_index;
+    int body_line; // first line of the loop body, where NEXT jumps back to
+    int integral; // whole-number bounds: the loop counts on the integers below
+    long long counter;
+    long long limit;
+    long long increment;
 } ForLoop;
 
 typedef struct gosub_stack_t {
     int return_line;
+    int entry_line; // the line the GOSUB went to, names the subroutine for the sampler
 } GosubStack;
 
 typedef struct interpreter_t {
-    Line lines[MAX_LINES];
+    // everything below grows on demand, see grow_array()
+    Line *lines; // ordered gap buffer, see program/line_store.c
     int line_count;
-    Variable variables[MAX_VARIABLES];
+    int line_capacity;
+    int gap_start;
+    int gap_end;
+    Variable *variables; // referenced by slot, the array moves when it grows
     int variable_count;
-    int current_line;
+    int variable_capacity;
+    int *variable_hash;
+    int variable_hash_size;
+    volatile int current_line; // read by the --sample signal handler, so every update is stored
     int running;
-    ForLoop for_stack[MAX_FOR_STACK];
+    ForLoop *for_stack;
     int for_stack_top;
-    GosubStack gosub_stack[MAX_GOSUB_STACK];
+    int for_stack_capacity;
+    GosubStack *gosub_stack;
     int gosub_stack_top;
-    char *data_values[MAX_LINES];
+    int gosub_stack_capacity;
+    Value *data_values; // every DATA item in program order, see program/data_pool.c
     int data_count;
+    int data_capacity;
     int data_pointer;
+    UserFunction *functions; // referenced by slot like variables
+    int function_count;
+    int function_capacity;
+    const Value *frame; // arguments of the DEF FN call being evaluated
+    int call_depth;
+    OutputBuffer output; // PRINT text not yet on stdout, see interpreter/output.c
+    int profiling; // time the lines of the next runs
+    Profile *profile; // the times of the last profiled run, NULL when runs are not timed
+    int sample_interval; // microseconds of CPU time between samples of the next runs, 0 for none
+    Sampler *samples; // the samples of the last sampled run
     char error_message[256];
+    int quiet_errors; // set while the optimizer evaluates expressions that may fail
+    int resolved;
+    Arena arena;
+    int use_vm;
+    Bytecode *bytecode;
+    MappedFile image; // set while a compiled program image is loaded
 } Interpreter;
 
+void arena_init(Arena *arena);
+void *arena_alloc(Arena *arena, size_t size);
+char *arena_strndup(Arena *arena, const char *text, size_t length);
+void arena_adopt(Arena *arena, Arena *source);
+int arena_owns(const Arena *arena, const void *ptr);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+Interpreter *create_interpreter(void);
 void init_interpreter(Interpreter *interp);
 void cleanup_interpreter(Interpreter *interp);
+void destroy_interpreter(Interpreter *interp);
+void *grow_array(void *array, int *capacity, size_t item_size);
 int load_program(Interpreter *interp, const char *filename);
+int tokenize_line(Arena *arena, const char *text, size_t length, int default_number, Line *line);
+int map_file(const char *filename, MappedFile *file);
+void unmap_file(MappedFile *file);
 int parse_line(Interpreter *interp, const char *line_text);
 int execute_program(Interpreter *interp);
 int execute_line(Interpreter *interp, int line_index);
-Token *tokenize(const char *text, int *token_count);
-void cleanup_tokens(Token *tokens, int token_count);
-Value evaluate_expression(Interpreter *interp, Token *tokens, int start, int end);
+Token *tokenize(Arena *arena, const char *text, int *token_count);
+String *scan_string_literal(Arena *arena, const char **ptr);
+const Keyword *find_keyword(const char *text, size_t length);
+Statement *parse_statement(Interpreter *interp, Arena *arena, Token *tokens, int token_count);
+void optimize_statement(Interpreter *interp, Arena *arena, Statement *stmt);
+void dump_program(Interpreter *interp, FILE *out);
+const char *command_name(Command command);
+Value evaluate_node(Interpreter *interp, const Node *node);
+int evaluate_arguments(Interpreter *interp, const Node *node, Value *args);
+Value apply_operator(Interpreter *interp, Value left, Operator op, Value right);
+Value apply_integer_operator(Interpreter *interp, long long left, Operator op, long long right);
+Value apply_unary(Interpreter *interp, Operator op, Value operand);
+Value apply_function(Interpreter *interp, Function func, Value *args, int arg_count);
+int execute_statement(Interpreter *interp, const Statement *stmt);
+int format_number(double number, char *buffer);
+int format_integer(long long integer, char *buffer);
+void set_flush_policy(Interpreter *interp, FlushPolicy policy);
+void write_output(Interpreter *interp, const char *text, size_t length);
+void write_value(Interpreter *interp, const Value *value);
+void flush_output(Interpreter *interp);
+int begin_profile(Interpreter *interp);
+void profile_line(Interpreter *interp, int line);
+void end_profile(Interpreter *interp);
+void free_profile(Profile *profile);
+void write_profile_report(Interpreter *interp, FILE *out);
+void write_profile_stacks(Interpreter *interp, FILE *out);
+int start_sampling(Interpreter *interp);
+void stop_sampling(Interpreter *interp);
+void free_samples(Sampler *sampler);
+void write_sample_report(Interpreter *interp, FILE *out);
+int input_prompts(void);
+int parse_number(const char *text, size_t length, double *number);
+char *read_input_line(size_t *length);
+int read_input_value(Interpreter *interp, const char *prompt, int field, int count, Value *value);
+int begin_for_loop(Interpreter *interp, int slot, Value start_val, Value end_val, Value step_val);
+int step_for_loop(Interpreter *interp, int *continue_loop);
+int push_gosub(Interpreter *interp, int return_line, int entry_line);
+int pop_gosub(Interpreter *interp, int *return_line);
+int select_jump(Interpreter *interp, Value selector, int count, int *choice);
+Bytecode *compile_program(Interpreter *interp);
+void free_bytecode(Bytecode *bytecode);
+void invalidate_bytecode(Interpreter *interp);
+int execute_bytecode(Interpreter *interp);
+int is_program_image(const char *filename);
+int write_program_image(Interpreter *interp, const char *image_path, const char *source_path);
+int load_program_image(Interpreter *interp, const char *image_path);
 Variable *get_variable(Interpreter *interp, const char *name);
 Variable *create_variable(Interpreter *interp, const char *name);
 void set_variable(Interpreter *interp, const char *name, Value value);
+int keep_strings(Interpreter *interp, const Arena *arena);
+int find_variable_slot(Interpreter *interp, const char *name);
+int resolve_variable(Interpreter *interp, const char *name);
+int set_variable_slot(Interpreter *interp, int slot, Value value);
+int append_to_variable(Interpreter *interp, int slot, Value *operands, int count);
+int coerce_value(Interpreter *interp, int integer, Value *value);
+int is_function_name(const char *name);
+int resolve_function(Interpreter *interp, const char *name);
+Value call_function(Interpreter *interp, int slot, Value *args, int count);
+int allocate_array(Interpreter *interp, Variable *var, const long long *bounds, int count);
+int dimension_array(Interpreter *interp, int slot, Value *bounds, int count);
+Value load_element(Interpreter *interp, int slot, Value *subscripts, int count);
+int store_element(Interpreter *interp, int slot, Value *subscripts, int count, Value value);
+void free_array(Variable *var);
+int assign_matrix(Interpreter *interp, MatOp op, int target, int left, int right, Value *args, int count);
 Value create_number_value(double number);
+Value create_integer_value(long long integer);
+int is_integer_name(const char *name);
+double to_number(Value value);
+int to_integer(Interpreter *interp, Value value, long long *integer);
 Value create_string_value(const char *string);
+String *create_string(const char *text, size_t length);
+String *append_string(String *string, const char *text, size_t length);
+Value retain_value(Value value);
 void cleanup_value(Value *value);
 Command get_command(const char *text);
 Operator get_operator(const char *text);
 Function get_function(const char *text);
 int find_line_by_number(Interpreter *interp, int line_number);
+Line *get_line(Interpreter *interp, int index);
+int store_line(Interpreter *interp, const Line *line);
+int delete_line(Interpreter *interp, int line_number);
+int append_line(Interpreter *interp, const Line *line);
+int sort_lines(Interpreter *interp);
+void compact_lines(Interpreter *interp);
+void resolve_program(Interpreter *interp);
+void build_data_pool(Interpreter *interp);
+int read_data(Interpreter *interp, Value *value);
+void restore_data(Interpreter *interp, int line_index);
+void invalidate_program(Interpreter *interp);
 void print_error(Interpreter *interp, const char *message);
-int execute_line_tokens(Interpreter *interp, Token *token, int token_count, int i);
 
-char* process_escape_sequences(const char* input);
 
 #endif
@@ -0,0 +1,71 @@
+#include "interpreter/basic_interpreter.h"
+
+// DEF FNA(X, Y) = body: the body is parsed once with its parameters as
+// NODE_PARAM frame positions, so a call binds the evaluated arguments to a
+// frame and never touches the global variables X and Y.
+
+// like the classic FN keyword, the prefix makes FNA, FNA$ and FNA% functions, never variables
+int is_function_name(const char *name) {
+    return toupper((unsigned char)name[0]) == 'F' && toupper((unsigned char)name[1]) == 'N' && name[2] != '\0';
+}
+
+// functions are resolved to slots by name when lines are parsed, case-insensitively like variables
+int resolve_function(Interpreter *interp, const char *name) {
+    for (int i = 0; i < interp->function_count; i++) {
+        if (strcasecmp(interp->functions[i].name, name) == 0) return i;
+    }
+
+    if (interp->function_count >= interp->function_capacity) {
+        UserFunction *functions = grow_array(interp->functions, &interp->function_capacity, sizeof(UserFunction));
+        if (!functions) return -1;
+        interp->functions = functions;
+    }
+
+    UserFunction *function = &interp->functions[interp->function_count];
+    strncpy(function->name, name, sizeof(function->name) - 1);
+    function->name[sizeof(function->name) - 1] = '\0';
+    function->definition = NULL;
+    return interp->function_count++;
+}
+
+// consumes the arguments; the frame lives on the C stack for the length of the call
+Value call_function(Interpreter *interp, int slot, Value *args, int count) {
+    const UserFunction *function = &interp->functions[slot];
+    const Statement *definition = function->definition;
+    Value result = create_number_value(0);
+
+    int ok = 1;
+    if (!definition) {
+        print_error(interp, "Undefined function");
+        ok = 0;
+    } else if (count != definition->target->arg_count) {
+        print_error(interp, "Wrong number of function arguments");
+        ok = 0;
+    } else if (interp->call_depth >= MAX_FUNCTION_DEPTH) {
+        print_error(interp, "Function calls nested too deeply");
+        ok = 0;
+    }
+
+    // parameters convert like variables of the same name
+    for (int i = 0; ok && i < count; i++) {
+        ok = coerce_value(interp, is_integer_name(definition->target->args[i]->name), &args[i]);
+    }
+
+    if (ok) {
+        const Value *caller_frame = interp->frame;
+        interp->frame = args;
+        interp->call_depth++;
+        result = evaluate_node(interp, definition->expr);
+        interp->call_depth--;
+        interp->frame = caller_frame;
+
+        if (strlen(interp->error_message) == 0) {
+            coerce_value(interp, is_integer_name(function->name), &result);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        cleanup_value(&args[i]);
+    }
+    return result;
+}
@@ -0,0 +1,229 @@
+#include "interpreter/basic_interpreter.h"
+#include <errno.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define read _read
+#define STDIN_FILENO 0
+#else
+#include <unistd.h>
+#endif
+
+// stdin is read in blocks into one buffer that INPUT and the REPL share,
+// since they read the same stream. on a terminal a read returns a line at
+// a time anyway; from a pipe or a file one read brings in many lines, and
+// prompts are left out so they do not mix with the program output.
+
+typedef struct input_t {
+    char *data;
+    size_t start; // first byte not handed out yet
+    size_t length;
+    size_t capacity;
+    int eof;
+    int prompts; // -1 until stdin has been checked
+    char *fields; // INPUT A, B, C: the unread part of the current line, NULL when used up
+} InputBuffer;
+
+// stdin belongs to the process, so its buffer does too
+static InputBuffer input = {NULL, 0, 0, 0, 0, -1, NULL};
+
+static const double exact_powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+int input_prompts(void) {
+    if (input.prompts == -1) {
+        input.prompts = isatty(STDIN_FILENO);
+    }
+    return input.prompts;
+}
+
+// plain decimal text, [+-]digits[.digits][e[+-]digits] and nothing else; hex,
+// INF and NAN stay strings. up to 2^53 with a power of ten up to 22 the
+// result is one exact operation, longer numbers go through strtod, which
+// parses in the C locale since the interpreter never sets one
+int parse_number(const char *text, size_t length, double *number) {
+    const char *ptr = text;
+    const char *end = text + length;
+    const int negative = ptr < end && *ptr == '-';
+    if (ptr < end && (*ptr == '+' || *ptr == '-')) ptr++;
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int significant = 0;
+    int exponent = 0;
+    for (; ptr < end && isdigit((unsigned char)*ptr); ptr++, digits++) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (unsigned long long)(*ptr - '0');
+            significant += mantissa > 0;
+        } else {
+            exponent++;
+        }
+    }
+    if (ptr < end && *ptr == '.') {
+        for (ptr++; ptr < end && isdigit((unsigned char)*ptr); ptr++, digits++) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (unsigned long long)(*ptr - '0');
+                significant += mantissa > 0;
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) return 0;
+
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        ptr++;
+        const int negative_exponent = ptr < end && *ptr == '-';
+        if (ptr < end && (*ptr == '+' || *ptr == '-')) ptr++;
+        if (ptr == end || !isdigit((unsigned char)*ptr)) return 0;
+
+        int power = 0;
+        for (; ptr < end && isdigit((unsigned char)*ptr); ptr++) {
+            if (power < 100000) power = power * 10 + (*ptr - '0');
+        }
+        exponent += negative_exponent ? -power : power;
+    }
+    if (ptr != end) return 0;
+
+    if (significant < 19 && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        const double value = (double)mantissa;
+        const double result = exponent < 0 ? value / exact_powers[-exponent] : value * exact_powers[exponent];
+        *number = negative ? -result : result;
+        return 1;
+    }
+
+    char buffer[64];
+    char *copy = length < sizeof(buffer) ? buffer : malloc(length + 1);
+    if (!copy) return 0;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    *number = strtod(copy, NULL);
+    if (copy != buffer) free(copy);
+    return 1;
+}
+
+// reads another block behind the unread bytes, keeping one byte spare for a terminator
+static int fill_input(void) {
+    if (input.start > 0) {
+        memmove(input.data, input.data + input.start, input.length - input.start);
+        input.length -= input.start;
+        input.start = 0;
+    }
+    if (input.length + 1 >= input.capacity) {
+        const size_t capacity = input.capacity ? input.capacity * 2 : INPUT_BUFFER_SIZE;
+        char *data = realloc(input.data, capacity);
+        if (!data) return 0;
+        input.data = data;
+        input.capacity = capacity;
+    }
+
+    long count;
+    do {
+        count = (long)read(STDIN_FILENO, input.data + input.length, input.capacity - input.length - 1);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) return 0;
+
+    input.length += (size_t)count;
+    return 1;
+}
+
+// the next line without its line ending, terminated in place; NULL at the end of input
+char *read_input_line(size_t *length) {
+    size_t scanned = input.start;
+    while (1) {
+        char *newline = input.data ? memchr(input.data + scanned, '\n', input.length - scanned) : NULL;
+        if (newline || input.eof) {
+            if (!newline && input.start == input.length) return NULL;
+
+            char *line = input.data + input.start;
+            size_t line_length = newline ? (size_t)(newline - line) : input.length - input.start;
+            input.start += line_length + (newline != NULL);
+            if (line_length > 0 && line[line_length - 1] == '\r') line_length--;
+            line[line_length] = '\0';
+            *length = line_length;
+            return line;
+        }
+
+        scanned = input.length - input.start;
+        if (!fill_input()) input.eof = 1;
+        scanned += input.start;
+    }
+}
+
+// a number when all of the trimmed text is one, otherwise the text as given
+static Value input_value(const char *text, size_t length) {
+    const char *start = text;
+    const char *end = text + length;
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+
+    double number;
+    if (parse_number(start, (size_t)(end - start), &number)) {
+        return create_number_value(number);
+    }
+
+    Value value;
+    value.type = VALUE_STRING;
+    value.data.string = create_string(text, length);
+    return value;
+}
+
+// the next comma-separated field; a quoted field keeps its commas and spaces
+static Value next_field(void) {
+    char *ptr = input.fields;
+    while (*ptr == ' ' || *ptr == '\t') ptr++;
+
+    Value value;
+    if (*ptr == '"') {
+        char *start = ++ptr;
+        while (*ptr && *ptr != '"') ptr++;
+        value.type = VALUE_STRING;
+        value.data.string = create_string(start, (size_t)(ptr - start));
+        while (*ptr && *ptr != ',') ptr++;
+    } else {
+        char *start = ptr;
+        while (*ptr && *ptr != ',') ptr++;
+        char *end = ptr;
+        while (end > start && isspace((unsigned char)end[-1])) end--;
+        value = input_value(start, (size_t)(end - start));
+    }
+
+    input.fields = *ptr == ',' ? ptr + 1 : NULL;
+    return value;
+}
+
+// value for target number field of an INPUT with count targets: a single
+// target takes the whole line, several take one field each and read another
+// line when the current one runs out; fields left over when the statement
+// ends are ignored. returns 0 at the end of input or with an error
+int read_input_value(Interpreter *interp, const char *prompt, int field, int count, Value *value) {
+    if (field == 0 || !input.fields) {
+        if (input_prompts()) {
+            if (field == 0 && prompt) write_output(interp, prompt, strlen(prompt));
+            write_output(interp, field == 0 ? "? " : "?? ", field == 0 ? 2 : 3);
+            flush_output(interp);
+        }
+
+        size_t length;
+        char *line = read_input_line(&length);
+        input.fields = NULL;
+        if (!line) return 0;
+
+        if (count == 1) {
+            *value = input_value(line, length);
+        } else {
+            input.fields = line;
+        }
+    }
+    if (count > 1) {
+        *value = next_field();
+    }
+
+    if (value->type == VALUE_STRING && !value->data.string) {
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,366 @@
+#include "interpreter/basic_interpreter.h"
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_X86
+#include <immintrin.h>
+#endif
+
+// MAT statements work on whole A() arrays, row-major blocks of doubles.
+// the element loops are small kernels picked once by what the CPU supports:
+// AVX, SSE2 or plain C. the vector kernels multiply and add separately, never
+// fused, so they round exactly like the scalar loops.
+
+#define MATRIX_BLOCK 64 // a 64x64 block of doubles is 32 KB and stays in cache
+
+typedef struct matrix_kernels_t {
+    void (*add)(double *out, const double *a, const double *b, size_t n);
+    void (*subtract)(double *out, const double *a, const double *b, size_t n);
+    void (*scale)(double *out, const double *a, double k, size_t n);
+    void (*accumulate)(double *out, const double *a, double k, size_t n); // out += k * a
+} MatrixKernels;
+
+static void add_scalar(double *out, const double *a, const double *b, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] + b[i];
+}
+
+static void subtract_scalar(double *out, const double *a, const double *b, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = a[i] - b[i];
+}
+
+static void scale_scalar(double *out, const double *a, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] = k * a[i];
+}
+
+static void accumulate_scalar(double *out, const double *a, double k, size_t n) {
+    for (size_t i = 0; i < n; i++) out[i] += k * a[i];
+}
+
+static const MatrixKernels scalar_kernels = {add_scalar, subtract_scalar, scale_scalar, accumulate_scalar};
+
+#ifdef MATRIX_X86
+__attribute__((target("sse2")))
+static void add_sse2(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) out[i] = a[i] + b[i];
+}
+
+__attribute__((target("sse2")))
+static void subtract_sse2(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) out[i] = a[i] - b[i];
+}
+
+__attribute__((target("sse2")))
+static void scale_sse2(double *out, const double *a, double k, size_t n) {
+    const __m128d factor = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(factor, _mm_loadu_pd(a + i)));
+    }
+    for (; i < n; i++) out[i] = k * a[i];
+}
+
+__attribute__((target("sse2")))
+static void accumulate_sse2(double *out, const double *a, double k, size_t n) {
+    const __m128d factor = _mm_set1_pd(k);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d product = _mm_mul_pd(factor, _mm_loadu_pd(a + i));
+        _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(out + i), product));
+    }
+    for (; i < n; i++) out[i] += k * a[i];
+}
+
+__attribute__((target("avx")))
+static void add_avx(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) out[i] = a[i] + b[i];
+}
+
+__attribute__((target("avx")))
+static void subtract_avx(double *out, const double *a, const double *b, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) out[i] = a[i] - b[i];
+}
+
+__attribute__((target("avx")))
+static void scale_avx(double *out, const double *a, double k, size_t n) {
+    const __m256d factor = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(factor, _mm256_loadu_pd(a + i)));
+    }
+    for (; i < n; i++) out[i] = k * a[i];
+}
+
+__attribute__((target("avx")))
+static void accumulate_avx(double *out, const double *a, double k, size_t n) {
+    const __m256d factor = _mm256_set1_pd(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256d low = _mm256_mul_pd(factor, _mm256_loadu_pd(a + i));
+        const __m256d high = _mm256_mul_pd(factor, _mm256_loadu_pd(a + i + 4));
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(out + i), low));
+        _mm256_storeu_pd(out + i + 4, _mm256_add_pd(_mm256_loadu_pd(out + i + 4), high));
+    }
+    for (; i < n; i++) out[i] += k * a[i];
+}
+
+static const MatrixKernels sse2_kernels = {add_sse2, subtract_sse2, scale_sse2, accumulate_sse2};
+static const MatrixKernels avx_kernels = {add_avx, subtract_avx, scale_avx, accumulate_avx};
+#endif
+
+// chosen on first use, the CPU does not change while the program runs
+static const MatrixKernels *matrix_kernels(void) {
+    static const MatrixKernels *kernels = NULL;
+    if (!kernels) {
+        kernels = &scalar_kernels;
+#ifdef MATRIX_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx")) {
+            kernels = &avx_kernels;
+        } else if (__builtin_cpu_supports("sse2")) {
+            kernels = &sse2_kernels;
+        }
+#endif
+    }
+    return kernels;
+}
+
+static size_t min_size(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+// out = a * b for a rows x inner and b inner x columns, in blocks so the rows of b
+// being reused stay in cache. every out element still sums its products in order
+// of the inner index, so the result matches the textbook triple loop exactly.
+static void multiply_blocked(double *out, const double *a, const double *b,
+                             size_t rows, size_t inner, size_t columns) {
+    const MatrixKernels *kernels = matrix_kernels();
+    memset(out, 0, sizeof(double) * rows * columns);
+
+    for (size_t row_block = 0; row_block < rows; row_block += MATRIX_BLOCK) {
+        const size_t row_end = min_size(row_block + MATRIX_BLOCK, rows);
+        for (size_t inner_block = 0; inner_block < inner; inner_block += MATRIX_BLOCK) {
+            const size_t inner_end = min_size(inner_block + MATRIX_BLOCK, inner);
+            for (size_t column_block = 0; column_block < columns; column_block += MATRIX_BLOCK) {
+                const size_t width = min_size(MATRIX_BLOCK, columns - column_block);
+                for (size_t i = row_block; i < row_end; i++) {
+                    double *out_row = out + i * columns + column_block;
+                    for (size_t p = inner_block; p < inner_end; p++) {
+                        kernels->accumulate(out_row, b + p * columns + column_block, a[i * inner + p], width);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// out = the transpose of a, rows x columns; blocked so neither side strides through memory
+static void transpose_blocked(double *out, const double *a, size_t rows, size_t columns) {
+    for (size_t row_block = 0; row_block < rows; row_block += MATRIX_BLOCK) {
+        const size_t row_end = min_size(row_block + MATRIX_BLOCK, rows);
+        for (size_t column_block = 0; column_block < columns; column_block += MATRIX_BLOCK) {
+            const size_t column_end = min_size(column_block + MATRIX_BLOCK, columns);
+            for (size_t i = row_block; i < row_end; i++) {
+                for (size_t j = column_block; j < column_end; j++) {
+                    out[j * rows + i] = a[i * columns + j];
+                }
+            }
+        }
+    }
+}
+
+static Variable *matrix_operand(Interpreter *interp, int slot) {
+    Variable *var = &interp->variables[slot];
+    if (!var->is_array) {
+        print_error(interp, "Array not dimensioned");
+        return NULL;
+    }
+    return var;
+}
+
+static int is_two_dimensional(Interpreter *interp, const Variable *var) {
+    if (var->dimensions != 2) {
+        print_error(interp, "Matrix must be two-dimensional");
+        return 0;
+    }
+    return 1;
+}
+
+// gives the target the shape of the result, keeping its storage when the shape already matches
+static int shape_matrix(Interpreter *interp, Variable *var, int dimensions, const int *dim_sizes) {
+    if (var->is_array && var->dimensions == dimensions &&
+        memcmp(var->dim_sizes, dim_sizes, sizeof(int) * (size_t)dimensions) == 0) {
+        return 1;
+    }
+
+    long long bounds[MAX_ARRAY_DIMENSIONS];
+    for (int i = 0; i < dimensions; i++) bounds[i] = dim_sizes[i] - 1;
+    return allocate_array(interp, var, bounds, dimensions);
+}
+
+static int fill_matrix(Interpreter *interp, MatOp op, int target, const long long *bounds, int count) {
+    Variable *var = &interp->variables[target];
+    if (count > 0) {
+        if (!allocate_array(interp, var, bounds, count)) return 0;
+    } else if (!matrix_operand(interp, target)) {
+        return 0;
+    }
+
+    if (op == MAT_IDN) {
+        if (!is_two_dimensional(interp, var)) return 0;
+        if (var->dim_sizes[0] != var->dim_sizes[1]) {
+            print_error(interp, "Matrix must be square");
+            return 0;
+        }
+    }
+
+    double *data = var->array_data;
+    const double value = op == MAT_CON ? 1.0 : 0.0;
+    for (size_t i = 0; i < var->element_count; i++) data[i] = value;
+    if (op == MAT_IDN) {
+        const size_t diagonal_stride = var->strides[0] + 1;
+        for (int i = 0; i < var->dim_sizes[0]; i++) data[(size_t)i * diagonal_stride] = 1.0;
+    }
+    return 1;
+}
+
+// copy, scale, add and subtract: the result has the shape of the sources, so a
+// target that is also a source keeps its storage and is updated in place
+static int map_matrix(Interpreter *interp, MatOp op, Variable *out, const Variable *a, const Variable *b, double factor) {
+    if (b && (a->dimensions != b->dimensions ||
+              memcmp(a->dim_sizes, b->dim_sizes, sizeof(int) * (size_t)a->dimensions) != 0)) {
+        print_error(interp, "Matrix dimensions do not match");
+        return 0;
+    }
+    if (!shape_matrix(interp, out, a->dimensions, a->dim_sizes)) return 0;
+
+    const MatrixKernels *kernels = matrix_kernels();
+    double *result = out->array_data;
+    const size_t n = a->element_count;
+    switch (op) {
+        case MAT_ADD:
+            kernels->add(result, a->array_data, b->array_data, n);
+            break;
+        case MAT_SUBTRACT:
+            kernels->subtract(result, a->array_data, b->array_data, n);
+            break;
+        case MAT_SCALE:
+            kernels->scale(result, a->array_data, factor, n);
+            break;
+        default:
+            if (out != a) memcpy(result, a->array_data, sizeof(double) * n);
+            break;
+    }
+    return 1;
+}
+
+// the product and the transpose change shape, so a target that is also a source
+// gets the result through a scratch block instead of overwriting its own input
+static int reshape_matrix(Interpreter *interp, MatOp op, Variable *out, const Variable *a, const Variable *b) {
+    if (!is_two_dimensional(interp, a) || (b && !is_two_dimensional(interp, b))) return 0;
+
+    const size_t rows = (size_t)a->dim_sizes[0];
+    const size_t inner = (size_t)a->dim_sizes[1];
+    size_t columns = inner;
+    int shape[2] = {a->dim_sizes[1], a->dim_sizes[0]};
+    if (op == MAT_MULTIPLY) {
+        if (a->dim_sizes[1] != b->dim_sizes[0]) {
+            print_error(interp, "Matrix dimensions do not match");
+            return 0;
+        }
+        columns = (size_t)b->dim_sizes[1];
+        shape[0] = a->dim_sizes[0];
+        shape[1] = b->dim_sizes[1];
+    }
+
+    const int aliased = out == a || out == b;
+    double *result;
+    if (aliased) {
+        if (rows > SIZE_MAX / sizeof(double) / columns) {
+            print_error(interp, "Array too large");
+            return 0;
+        }
+        result = malloc(sizeof(double) * rows * columns);
+        if (!result) {
+            print_error(interp, "Out of memory");
+            return 0;
+        }
+    } else {
+        if (!shape_matrix(interp, out, 2, shape)) return 0;
+        result = out->array_data;
+    }
+
+    if (op == MAT_MULTIPLY) {
+        multiply_blocked(result, a->array_data, b->array_data, rows, inner, columns);
+    } else {
+        transpose_blocked(result, a->array_data, rows, inner);
+    }
+
+    if (aliased) {
+        if (!shape_matrix(interp, out, 2, shape)) {
+            free(result);
+            return 0;
+        }
+        memcpy(out->array_data, result, sizeof(double) * rows * columns);
+        free(result);
+    }
+    return 1;
+}
+
+// MAT target = ...: consumes the arguments, the scale factor of MAT_SCALE or
+// the new bounds of ZER, CON and IDN; left and right are -1 when unused
+int assign_matrix(Interpreter *interp, MatOp op, int target, int left, int right, Value *args, int count) {
+    double factor = 0;
+    long long bounds[MAX_ARRAY_DIMENSIONS];
+    int ok = count <= MAX_ARRAY_DIMENSIONS;
+    if (!ok) print_error(interp, "Invalid array dimension");
+
+    for (int i = 0; i < count; i++) {
+        if (ok && op == MAT_SCALE) {
+            if (args[i].type == VALUE_STRING) {
+                print_error(interp, "Type mismatch");
+                ok = 0;
+            }
+            factor = to_number(args[i]);
+        } else if (ok) {
+            ok = to_integer(interp, args[i], &bounds[i]);
+        }
+        cleanup_value(&args[i]);
+    }
+    if (!ok) return 0;
+
+    switch (op) {
+        case MAT_ZER:
+        case MAT_CON:
+        case MAT_IDN:
+            return fill_matrix(interp, op, target, bounds, count);
+        default:
+            break;
+    }
+
+    const Variable *a = matrix_operand(interp, left);
+    if (!a) return 0;
+    const Variable *b = NULL;
+    if (right >= 0 && !(b = matrix_operand(interp, right))) return 0;
+
+    Variable *out = &interp->variables[target];
+    if (op == MAT_MULTIPLY || op == MAT_TRN) {
+        return reshape_matrix(interp, op, out, a, b);
+    }
+    return map_matrix(interp, op, out, a, b, factor);
+}
@@ -0,0 +1,183 @@
+#include "interpreter/basic_interpreter.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define isatty _isatty
+#define STDOUT_FILENO 1
+#else
+#include <unistd.h>
+#endif
+
+// PRINT writes into a buffer owned by the interpreter instead of going
+// through printf for every item. the flush policy decides when the buffer
+// reaches stdout; it is always flushed before input is read, before an
+// error is printed and when the program ends, so the order of everything
+// on stdout stays the same.
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20
+};
+
+// writes the digits of a positive number right to left, ending before end
+static char *format_digits(char *end, unsigned long long number) {
+    do {
+        *--end = (char)('0' + number % 10);
+        number /= 10;
+    } while (number > 0);
+    return end;
+}
+
+int format_integer(long long integer, char *buffer) {
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    const unsigned long long magnitude = integer < 0 ? 0ULL - (unsigned long long)integer : (unsigned long long)integer;
+    char *start = format_digits(end, magnitude);
+    if (integer < 0) *--start = '-';
+
+    const int length = (int)(end - start);
+    memcpy(buffer, start, (size_t)length);
+    buffer[length] = '\0';
+    return length;
+}
+
+// six significant digits of number, rounded to nearest; 0 when the exact
+// binary value lies too close to a tie for the scaled double to decide it
+static int significant_digits(double number, int *exponent, long long *digits) {
+    int e = (int)floor(log10(number));
+    for (int attempt = 0; attempt < 2; attempt++) {
+        const int scale = 5 - e;
+        if (scale < -20 || scale > 20) return 0;
+
+        // one rounding step, so the scaled value is within an ulp of exact
+        const double scaled = scale >= 0 ? number * powers_of_ten[scale] : number / powers_of_ten[-scale];
+        const double fraction = scaled - floor(scaled);
+        if (fabs(fraction - 0.5) < 1e-6) return 0;
+
+        const long long rounded = (long long)floor(scaled) + (fraction > 0.5);
+        if (rounded >= 1000000) {
+            e++; // log10 was low or 999999.5 rounded up
+        } else if (rounded < 100000) {
+            e--;
+        } else {
+            *exponent = e;
+            *digits = rounded;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// the text printf("%.6g") produces, without parsing a format; buffer holds NUMBER_TEXT_SIZE bytes
+int format_number(double number, char *buffer) {
+    int exponent;
+    long long digits;
+    if (number == 0 || !isfinite(number) || !significant_digits(fabs(number), &exponent, &digits)) {
+        return snprintf(buffer, NUMBER_TEXT_SIZE, "%.6g", number);
+    }
+
+    char text[6];
+    format_digits(text + 6, (unsigned long long)digits);
+    int count = 6;
+    while (text[count - 1] == '0') count--; // %g drops trailing zeros
+
+    char *out = buffer;
+    if (signbit(number)) *out++ = '-';
+
+    if (exponent < -4 || exponent >= 6) {
+        *out++ = text[0];
+        if (count > 1) {
+            *out++ = '.';
+            memcpy(out, text + 1, (size_t)count - 1);
+            out += count - 1;
+        }
+        *out++ = 'e';
+        *out++ = exponent < 0 ? '-' : '+';
+        const int magnitude = abs(exponent);
+        if (magnitude >= 100) *out++ = (char)('0' + magnitude / 100);
+        *out++ = (char)('0' + magnitude / 10 % 10);
+        *out++ = (char)('0' + magnitude % 10);
+    } else if (exponent >= 0) {
+        memcpy(out, text, (size_t)exponent + 1);
+        out += exponent + 1;
+        if (count > exponent + 1) {
+            *out++ = '.';
+            memcpy(out, text + exponent + 1, (size_t)(count - exponent - 1));
+            out += count - exponent - 1;
+        }
+    } else {
+        *out++ = '0';
+        *out++ = '.';
+        for (int i = exponent + 1; i < 0; i++) *out++ = '0';
+        memcpy(out, text, (size_t)count);
+        out += count;
+    }
+
+    *out = '\0';
+    return (int)(out - buffer);
+}
+
+void set_flush_policy(Interpreter *interp, FlushPolicy policy) {
+    if (policy == FLUSH_AUTO) {
+        policy = isatty(STDOUT_FILENO) ? FLUSH_LINE : FLUSH_BLOCK;
+    }
+    interp->output.policy = policy;
+}
+
+void flush_output(Interpreter *interp) {
+    OutputBuffer *output = &interp->output;
+    if (output->length > 0) {
+        fwrite(output->data, 1, output->length, stdout);
+        output->length = 0;
+    }
+    fflush(stdout);
+}
+
+// room for length more bytes; 0 when the text has to go to stdout directly
+static int reserve_output(OutputBuffer *output, size_t length) {
+    if (output->length + length <= output->capacity) return 1;
+
+    if (output->policy == FLUSH_EXIT || !output->data) {
+        size_t capacity = output->capacity ? output->capacity : OUTPUT_BUFFER_SIZE;
+        while (capacity < output->length + length) capacity *= 2;
+        if (output->policy != FLUSH_EXIT && capacity > OUTPUT_BUFFER_SIZE) return 0;
+
+        char *data = realloc(output->data, capacity);
+        if (data) {
+            output->data = data;
+            output->capacity = capacity;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void write_output(Interpreter *interp, const char *text, size_t length) {
+    OutputBuffer *output = &interp->output;
+    if (!reserve_output(output, length)) {
+        flush_output(interp);
+        if (!reserve_output(output, length)) {
+            fwrite(text, 1, length, stdout);
+            if (output->policy == FLUSH_LINE) fflush(stdout);
+            return;
+        }
+    }
+
+    memcpy(output->data + output->length, text, length);
+    output->length += length;
+    if (output->policy == FLUSH_LINE && memchr(text, '\n', length)) {
+        flush_output(interp);
+    }
+}
+
+// one PRINT item, numbers never contain a newline
+void write_value(Interpreter *interp, const Value *value) {
+    char buffer[NUMBER_TEXT_SIZE];
+    if (value->type == VALUE_NUMBER) {
+        write_output(interp, buffer, (size_t)format_number(value->data.number, buffer));
+    } else if (value->type == VALUE_INTEGER) {
+        write_output(interp, buffer, (size_t)format_integer(value->data.integer, buffer));
+    } else if (value->type == VALUE_STRING && value->data.string) {
+        write_output(interp, value->data.string->data, value->data.string->length);
+    }
+}
@@ -0,0 +1,317 @@
+#include "interpreter/basic_interpreter.h"
+#include <time.h>
+
+// --profile and PROFILE time every program line: both engines call
+// profile_line() when a line starts, which charges the time since the
+// previous start to the previous line. interp->profile is NULL otherwise,
+// so a normal run only pays for that test. time is also kept per GOSUB
+// call path for the collapsed-stack file that flame graph tools read.
+
+typedef struct profile_line_t {
+    long long count;
+    long long nanoseconds;
+} ProfileLine;
+
+// a GOSUB call path: the caller's path and the first line of the subroutine
+typedef struct profile_frame_t {
+    int parent;
+    int entry;
+} ProfileFrame;
+
+// the time of one line under one call path
+typedef struct profile_stack_t {
+    int frame;
+    int line;
+    long long nanoseconds;
+} ProfileStack;
+
+typedef struct profile_slot_t {
+    unsigned long long key;
+    int index; // into frames or stacks, -1 when the slot is free
+} ProfileSlot;
+
+struct profile_t {
+    ProfileLine *lines; // indexed like interp->lines
+    int line_count;
+    ProfileFrame *frames; // frames[0] is the main program
+    int frame_count;
+    int frame_capacity;
+    ProfileStack *stacks;
+    int stack_count;
+    int stack_capacity;
+    ProfileSlot *slots; // finds frames and stacks by key, see find_slot()
+    int slot_count;
+    int used_slots;
+    int *path; // the frame of every GOSUB level in progress, path[0] is 0
+    int depth;
+    int path_capacity;
+    int line; // the line being timed, -1 before the first
+    int stack;
+    long long started;
+};
+
+static long long monotonic_ns(void) {
+    struct timespec now;
+#ifdef _WIN32
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int grow_slots(Profile *profile) {
+    const int count = profile->slot_count ? profile->slot_count * 2 : 1024;
+    ProfileSlot *slots = malloc(sizeof(ProfileSlot) * (size_t)count);
+    if (!slots) return 0;
+    for (int i = 0; i < count; i++) slots[i].index = -1;
+
+    for (int i = 0; i < profile->slot_count; i++) {
+        if (profile->slots[i].index < 0) continue;
+        int slot = (int)(profile->slots[i].key * 0x9E3779B97F4A7C15ULL >> 40) & (count - 1);
+        while (slots[slot].index >= 0) slot = (slot + 1) & (count - 1);
+        slots[slot] = profile->slots[i];
+    }
+    free(profile->slots);
+    profile->slots = slots;
+    profile->slot_count = count;
+    return 1;
+}
+
+// the slot holding key, or the free slot where it belongs; NULL when out of memory
+static ProfileSlot *find_slot(Profile *profile, unsigned long long key) {
+    if (profile->used_slots * 2 >= profile->slot_count && !grow_slots(profile)) return NULL;
+
+    const int mask = profile->slot_count - 1;
+    int slot = (int)(key * 0x9E3779B97F4A7C15ULL >> 40) & mask;
+    while (profile->slots[slot].index >= 0 && profile->slots[slot].key != key) {
+        slot = (slot + 1) & mask;
+    }
+    return &profile->slots[slot];
+}
+
+// frames and stacks share the table, told apart by the low bit of the key
+static int find_frame(Profile *profile, int parent, int entry) {
+    const unsigned long long key = ((unsigned long long)parent << 32 | (unsigned)entry) << 1 | 1;
+    ProfileSlot *slot = find_slot(profile, key);
+    if (!slot) return parent;
+    if (slot->index >= 0) return slot->index;
+
+    if (profile->frame_count >= profile->frame_capacity) {
+        ProfileFrame *frames = grow_array(profile->frames, &profile->frame_capacity, sizeof(ProfileFrame));
+        if (!frames) return parent;
+        profile->frames = frames;
+    }
+    profile->frames[profile->frame_count].parent = parent;
+    profile->frames[profile->frame_count].entry = entry;
+    slot->key = key;
+    slot->index = profile->frame_count;
+    profile->used_slots++;
+    return profile->frame_count++;
+}
+
+static int find_stack(Profile *profile, int frame, int line) {
+    const unsigned long long key = ((unsigned long long)frame << 32 | (unsigned)line) << 1;
+    ProfileSlot *slot = find_slot(profile, key);
+    if (!slot) return -1;
+    if (slot->index >= 0) return slot->index;
+
+    if (profile->stack_count >= profile->stack_capacity) {
+        ProfileStack *stacks = grow_array(profile->stacks, &profile->stack_capacity, sizeof(ProfileStack));
+        if (!stacks) return -1;
+        profile->stacks = stacks;
+    }
+    profile->stacks[profile->stack_count].frame = frame;
+    profile->stacks[profile->stack_count].line = line;
+    profile->stacks[profile->stack_count].nanoseconds = 0;
+    slot->key = key;
+    slot->index = profile->stack_count;
+    profile->used_slots++;
+    return profile->stack_count++;
+}
+
+void free_profile(Profile *profile) {
+    if (!profile) return;
+    free(profile->lines);
+    free(profile->frames);
+    free(profile->stacks);
+    free(profile->slots);
+    free(profile->path);
+    free(profile);
+}
+
+// replaces the counts of an earlier run; called once the program is resolved
+int begin_profile(Interpreter *interp) {
+    free_profile(interp->profile);
+    interp->profile = NULL;
+
+    Profile *profile = calloc(1, sizeof(Profile));
+    if (!profile) return 0;
+    profile->lines = calloc((size_t)interp->line_count + 1, sizeof(ProfileLine));
+    profile->line_count = interp->line_count;
+    profile->frames = malloc(sizeof(ProfileFrame) * 16);
+    profile->frame_capacity = 16;
+    profile->path = malloc(sizeof(int) * 16);
+    profile->path_capacity = 16;
+    if (!profile->lines || !profile->frames || !profile->path) {
+        free_profile(profile);
+        return 0;
+    }
+    profile->frames[0].parent = -1;
+    profile->frames[0].entry = -1;
+    profile->frame_count = 1;
+    profile->path[0] = 0;
+    profile->line = -1;
+    interp->profile = profile;
+    return 1;
+}
+
+static void charge_line(Profile *profile, long long now) {
+    const long long elapsed = now - profile->started;
+    profile->lines[profile->line].nanoseconds += elapsed;
+    if (profile->stack >= 0) profile->stacks[profile->stack].nanoseconds += elapsed;
+}
+
+void profile_line(Interpreter *interp, int line) {
+    Profile *profile = interp->profile;
+    const long long now = monotonic_ns();
+    if (profile->line >= 0) charge_line(profile, now);
+
+    // a GOSUB or RETURN since the last line changed the call path; a
+    // subroutine is named after the first line it runs
+    const int depth = interp->gosub_stack_top + 1;
+    if (depth < profile->depth) {
+        profile->depth = depth;
+    }
+    while (profile->depth < depth) {
+        if (profile->depth + 1 >= profile->path_capacity) {
+            int *path = grow_array(profile->path, &profile->path_capacity, sizeof(int));
+            if (!path) break;
+            profile->path = path;
+        }
+        const int parent = profile->path[profile->depth];
+        profile->path[++profile->depth] = find_frame(profile, parent, line);
+    }
+
+    profile->line = line;
+    profile->stack = find_stack(profile, profile->path[profile->depth], line);
+    profile->lines[line].count++;
+    profile->started = monotonic_ns();
+}
+
+// charges the last line when the run ends, normally or with an error
+void end_profile(Interpreter *interp) {
+    Profile *profile = interp->profile;
+    if (profile && profile->line >= 0) {
+        charge_line(profile, monotonic_ns());
+        profile->line = -1;
+    }
+}
+
+// the statement a line starts with; program images keep only the line text
+static Command line_command(const Line *line) {
+    if (line->statement) return line->statement->command;
+
+    const char *text = line->text ? line->text : "";
+    while (isspace((unsigned char)*text)) text++;
+    char word[16];
+    size_t length = 0;
+    while (isalpha((unsigned char)text[length]) && length < sizeof(word) - 1) {
+        word[length] = (char)toupper((unsigned char)text[length]);
+        length++;
+    }
+    word[length] = '\0';
+
+    const Command command = get_command(word);
+    return command == CMD_UNKNOWN && length > 0 ? CMD_LET : command;
+}
+
+static const Profile *sorting_profile;
+
+static int compare_lines(const void *a, const void *b) {
+    const ProfileLine *left = &sorting_profile->lines[*(const int *)a];
+    const ProfileLine *right = &sorting_profile->lines[*(const int *)b];
+    if (left->nanoseconds != right->nanoseconds) return left->nanoseconds < right->nanoseconds ? 1 : -1;
+    return *(const int *)a - *(const int *)b;
+}
+
+static double percent(long long part, long long total) {
+    return total > 0 ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+// lines and statement kinds, most time first
+void write_profile_report(Interpreter *interp, FILE *out) {
+    const Profile *profile = interp->profile;
+    if (!profile) return;
+
+    int *order = malloc(sizeof(int) * ((size_t)profile->line_count + 1));
+    if (!order) return;
+    ProfileLine commands[CMD_UNKNOWN + 1];
+    memset(commands, 0, sizeof(commands));
+
+    long long total = 0;
+    long long executed = 0;
+    int count = 0;
+    for (int i = 0; i < profile->line_count; i++) {
+        const ProfileLine *line = &profile->lines[i];
+        if (line->count == 0) continue;
+        total += line->nanoseconds;
+        executed += line->count;
+        order[count++] = i;
+
+        ProfileLine *command = &commands[line_command(get_line(interp, i))];
+        command->count += line->count;
+        command->nanoseconds += line->nanoseconds;
+    }
+    sorting_profile = profile;
+    qsort(order, (size_t)count, sizeof(int), compare_lines);
+
+    fprintf(out, "Profile: %lld lines executed in %.3f ms\n\n", executed, (double)total / 1e6);
+    fprintf(out, "%8s %12s %12s %7s  %s\n", "line", "count", "time ms", "time %", "source");
+    for (int i = 0; i < count; i++) {
+        const ProfileLine *line = &profile->lines[order[i]];
+        const Line *source = get_line(interp, order[i]);
+        fprintf(out, "%8d %12lld %12.3f %6.2f%%  %.60s\n", source->line_number, line->count,
+                (double)line->nanoseconds / 1e6, percent(line->nanoseconds, total), source->text ? source->text : "");
+    }
+
+    fprintf(out, "\n%-8s %12s %12s %7s\n", "command", "count", "time ms", "time %");
+    for (int done = 0; done <= CMD_UNKNOWN; done++) {
+        int best = -1;
+        for (int i = 0; i <= CMD_UNKNOWN; i++) {
+            if (commands[i].count > 0 && (best < 0 || commands[i].nanoseconds > commands[best].nanoseconds)) best = i;
+        }
+        if (best < 0) break;
+        fprintf(out, "%-8s %12lld %12.3f %6.2f%%\n", command_name((Command)best), commands[best].count,
+                (double)commands[best].nanoseconds / 1e6, percent(commands[best].nanoseconds, total));
+        commands[best].count = 0;
+    }
+    free(order);
+}
+
+// one "main;GOSUB 1000;line 1010 <microseconds>" line per line and call path
+void write_profile_stacks(Interpreter *interp, FILE *out) {
+    const Profile *profile = interp->profile;
+    if (!profile) return;
+
+    for (int i = 0; i < profile->stack_count; i++) {
+        const ProfileStack *stack = &profile->stacks[i];
+        const long long microseconds = (stack->nanoseconds + 500) / 1000;
+        if (microseconds == 0) continue;
+
+        // the frames from the innermost call outwards, printed the other way round
+        int depth = 0;
+        for (int frame = stack->frame; frame > 0; frame = profile->frames[frame].parent) depth++;
+        int *frames = malloc(sizeof(int) * ((size_t)depth + 1));
+        if (!frames) return;
+        int level = depth;
+        for (int frame = stack->frame; frame > 0; frame = profile->frames[frame].parent) frames[--level] = frame;
+
+        fputs("main", out);
+        for (int j = 0; j < depth; j++) {
+            fprintf(out, ";GOSUB %d", get_line(interp, profile->frames[frames[j]].entry)->line_number);
+        }
+        fprintf(out, ";line %d %lld\n", get_line(interp, stack->line)->line_number, microseconds);
+        free(frames);
+    }
+}
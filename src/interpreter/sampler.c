@@ -0,0 +1,306 @@
+#include "interpreter/basic_interpreter.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+#include <time.h>
+#endif
+
+// --sample takes a statistical profile instead of timing every line: a
+// SIGPROF timer interrupts the program every few hundred microseconds of
+// CPU time and the handler copies current_line and the entry lines of the
+// innermost GOSUB frames into a ring buffer. a thread drains the ring into
+// histograms, so neither engine does any work per line and the handler
+// never allocates or takes a lock.
+
+#define SAMPLE_FRAMES 16 // GOSUB levels kept per sample, innermost first
+#define SAMPLE_RING_SIZE 4096 // a power of two
+#define SAMPLE_DRAIN_NS 10000000L // the drain thread empties the ring every 10 ms
+
+struct sampler_t {
+    long long *self; // samples per line, indexed like interp->lines
+    long long *calls; // samples per subroutine with the subroutines it calls, by entry line
+    long long *inner; // samples per subroutine in its own lines, by entry line
+    long long *seen; // the last sample counted in calls, so recursion counts once
+    int line_count;
+    long long main; // samples outside any subroutine
+    long long count;
+    long long dropped; // the ring was full
+    long long deep; // more GOSUB levels than a sample keeps
+    int interval;
+    long long cpu_ns; // CPU time of the run, the kernel may round the interval up to its clock tick
+};
+
+void free_samples(Sampler *sampler) {
+    if (!sampler) return;
+    free(sampler->self);
+    free(sampler->calls);
+    free(sampler->inner);
+    free(sampler->seen);
+    free(sampler);
+}
+
+#ifdef _WIN32
+
+int start_sampling(Interpreter *interp) {
+    print_error(interp, "Sampling is not supported on this system");
+    return 0;
+}
+
+void stop_sampling(Interpreter *interp) {
+    (void)interp;
+}
+
+#else
+
+typedef struct sample_t {
+    int line;
+    int depth; // GOSUB levels in progress, entries holds up to SAMPLE_FRAMES of them
+    int entries[SAMPLE_FRAMES];
+} Sample;
+
+// one timer per process, so one sampled program at a time; the handler
+// fills ring[head] and the drain thread empties ring[tail]
+static Sample ring[SAMPLE_RING_SIZE];
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+static atomic_uint ring_dropped;
+static _Atomic(Interpreter *) sampled;
+static atomic_int draining;
+static pthread_t drain_thread;
+static int handler_installed;
+
+static void take_sample(int signal) {
+    (void)signal;
+    Interpreter *interp = atomic_load_explicit(&sampled, memory_order_relaxed);
+    if (!interp) return;
+
+    const unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring_tail, memory_order_acquire) >= SAMPLE_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring_dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    // push_gosub publishes a grown stack before it frees the old one, and
+    // fills a frame before it counts it, so the array and frames read here
+    // are valid wherever the program was interrupted
+    Sample *sample = &ring[head & (SAMPLE_RING_SIZE - 1)];
+    const int top = interp->gosub_stack_top;
+    const GosubStack *stack = interp->gosub_stack;
+    atomic_signal_fence(memory_order_acquire);
+    sample->line = interp->current_line;
+    sample->depth = top + 1;
+    for (int i = 0; i <= top && i < SAMPLE_FRAMES; i++) {
+        sample->entries[i] = stack[top - i].entry_line;
+    }
+    atomic_store_explicit(&ring_head, head + 1, memory_order_release);
+}
+
+// a line index taken mid-jump can be -1, and an entry written just before
+// its frame was pushed can be stale, so everything is checked here
+static void count_sample(Sampler *sampler, const Sample *sample) {
+    sampler->count++;
+    if (sample->line >= 0 && sample->line < sampler->line_count) {
+        sampler->self[sample->line]++;
+    }
+    if (sample->depth <= 0) {
+        sampler->main++;
+        return;
+    }
+    if (sample->depth > SAMPLE_FRAMES) sampler->deep++;
+
+    const int frames = sample->depth < SAMPLE_FRAMES ? sample->depth : SAMPLE_FRAMES;
+    for (int i = 0; i < frames; i++) {
+        const int entry = sample->entries[i];
+        if (entry < 0 || entry >= sampler->line_count) continue;
+        if (i == 0) sampler->inner[entry]++;
+        if (sampler->seen[entry] != sampler->count) {
+            sampler->seen[entry] = sampler->count;
+            sampler->calls[entry]++;
+        }
+    }
+}
+
+static void drain_samples(Sampler *sampler) {
+    const unsigned head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    for (; tail != head; tail++) {
+        count_sample(sampler, &ring[tail & (SAMPLE_RING_SIZE - 1)]);
+    }
+    atomic_store_explicit(&ring_tail, tail, memory_order_release);
+}
+
+static void *run_drain(void *arg) {
+    Sampler *sampler = arg;
+    const struct timespec pause = {0, SAMPLE_DRAIN_NS};
+    while (atomic_load(&draining)) {
+        drain_samples(sampler);
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+static long long cpu_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static int set_timer(int interval) {
+    struct itimerval timer;
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+    return setitimer(ITIMER_PROF, &timer, NULL) == 0;
+}
+
+// replaces the samples of an earlier run; called once the program is resolved
+int start_sampling(Interpreter *interp) {
+    free_samples(interp->samples);
+    interp->samples = NULL;
+
+    Sampler *sampler = calloc(1, sizeof(Sampler));
+    if (!sampler) {
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+    const size_t count = (size_t)interp->line_count + 1;
+    sampler->self = calloc(count, sizeof(long long));
+    sampler->calls = calloc(count, sizeof(long long));
+    sampler->inner = calloc(count, sizeof(long long));
+    sampler->seen = calloc(count, sizeof(long long));
+    sampler->line_count = interp->line_count;
+    sampler->interval = interp->sample_interval;
+    if (!sampler->self || !sampler->calls || !sampler->inner || !sampler->seen) {
+        free_samples(sampler);
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+
+    // the handler stays installed once it is, a SIGPROF still pending when
+    // the timer stops would otherwise end the process
+    if (!handler_installed) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = take_sample;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, NULL) != 0) {
+            free_samples(sampler);
+            print_error(interp, "Cannot start the sampling profiler");
+            return 0;
+        }
+        handler_installed = 1;
+    }
+
+    atomic_store(&ring_head, 0);
+    atomic_store(&ring_tail, 0);
+    atomic_store(&ring_dropped, 0);
+    atomic_store(&draining, 1);
+
+    // the drain thread inherits the mask, so only the program is interrupted
+    sigset_t profiling, saved;
+    sigemptyset(&profiling);
+    sigaddset(&profiling, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &profiling, &saved);
+    const int started = pthread_create(&drain_thread, NULL, run_drain, sampler) == 0;
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (!started) {
+        free_samples(sampler);
+        print_error(interp, "Cannot start the sampling profiler");
+        return 0;
+    }
+
+    interp->samples = sampler;
+    sampler->cpu_ns = cpu_time_ns();
+    atomic_store(&sampled, interp);
+    if (!set_timer(sampler->interval)) {
+        stop_sampling(interp);
+        print_error(interp, "Cannot start the sampling profiler");
+        return 0;
+    }
+    return 1;
+}
+
+void stop_sampling(Interpreter *interp) {
+    Sampler *sampler = interp->samples;
+    if (!sampler || !atomic_load(&sampled)) return;
+
+    set_timer(0);
+    sampler->cpu_ns = cpu_time_ns() - sampler->cpu_ns;
+    atomic_store(&sampled, NULL);
+    atomic_store(&draining, 0);
+    pthread_join(drain_thread, NULL);
+    drain_samples(sampler);
+    sampler->dropped = atomic_load(&ring_dropped);
+}
+
+#endif
+
+static double percent(long long part, long long total) {
+    return total > 0 ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+static const long long *sorting_counts;
+
+static int compare_counts(const void *a, const void *b) {
+    const long long left = sorting_counts[*(const int *)a];
+    const long long right = sorting_counts[*(const int *)b];
+    if (left != right) return left < right ? 1 : -1;
+    return *(const int *)a - *(const int *)b;
+}
+
+// the lines with samples in counts, most first; returns how many
+static int sort_counts(const long long *counts, int line_count, int *order) {
+    int count = 0;
+    for (int i = 0; i < line_count; i++) {
+        if (counts[i] > 0) order[count++] = i;
+    }
+    sorting_counts = counts;
+    qsort(order, (size_t)count, sizeof(int), compare_counts);
+    return count;
+}
+
+// lines, then subroutines, most samples first
+void write_sample_report(Interpreter *interp, FILE *out) {
+    const Sampler *sampler = interp->samples;
+    if (!sampler) return;
+
+    fprintf(out, "Samples: %lld in %.3f ms of CPU time, one per %.0f us (%d us asked for)", sampler->count,
+            (double)sampler->cpu_ns / 1e6, sampler->count > 0 ? (double)sampler->cpu_ns / 1e3 / (double)sampler->count : 0.0,
+            sampler->interval);
+    if (sampler->dropped > 0) fprintf(out, ", %lld dropped", sampler->dropped);
+    if (sampler->deep > 0) fprintf(out, ", %lld deeper than %d GOSUB levels", sampler->deep, SAMPLE_FRAMES);
+    fprintf(out, "\n\n");
+
+    int *order = malloc(sizeof(int) * ((size_t)sampler->line_count + 1));
+    if (!order) return;
+
+    static const char bar[] = "########################################";
+    int count = sort_counts(sampler->self, sampler->line_count, order);
+    const long long most = count > 0 ? sampler->self[order[0]] : 0;
+    fprintf(out, "%8s %10s %7s  %-40s  %s\n", "line", "samples", "%", "", "source");
+    for (int i = 0; i < count; i++) {
+        const long long samples = sampler->self[order[i]];
+        const Line *line = get_line(interp, order[i]);
+        fprintf(out, "%8d %10lld %6.2f%%  %-40.*s  %.40s\n", line->line_number, samples, percent(samples, sampler->count),
+                (int)(40 * samples / most), bar, line->text ? line->text : "");
+    }
+
+    fprintf(out, "\n%-12s %10s %7s %10s %7s\n", "subroutine", "self", "self %", "total", "total %");
+    fprintf(out, "%-12s %10lld %6.2f%% %10lld %6.2f%%\n", "main", sampler->main, percent(sampler->main, sampler->count),
+            sampler->count, percent(sampler->count, sampler->count));
+    count = sort_counts(sampler->calls, sampler->line_count, order);
+    for (int i = 0; i < count; i++) {
+        const int entry = order[i];
+        char name[32];
+        snprintf(name, sizeof(name), "GOSUB %d", get_line(interp, entry)->line_number);
+        fprintf(out, "%-12s %10lld %6.2f%% %10lld %6.2f%%\n", name, sampler->inner[entry],
+                percent(sampler->inner[entry], sampler->count), sampler->calls[entry],
+                percent(sampler->calls[entry], sampler->count));
+    }
+    free(order);
+}
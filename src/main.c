@@ -1,32 +1,65 @@
 #include "interpreter/basic_interpreter.h"
 #include <time.h>
 
+typedef struct options_t {
+    int use_vm;
+    int compile;
+    int dump_ast;
+    FlushPolicy flush;
+    int profile;
+    int sample; // microseconds between samples, 0 when not sampling
+    const char *filename;
+} Options;
+
 void print_usage() {
     printf("BASIC Interpreter Usage:\n");
-    printf("  basic_interpreter <filename>    - Load and run BASIC program from file\n");
-    printf("  basic_interpreter               - Interactive mode\n");
+    printf("  basic_interpreter [options] <filename> - Load and run BASIC program from file\n");
+    printf("  basic_interpreter [options]            - Interactive mode\n");
+    printf("\nOptions:\n");
+    printf("  --vm                            - Run programs on the bytecode VM\n");
+    printf("  --compile                       - Write a program image (prog.bas -> prog.basc) and exit\n");
+    printf("                                    images run on the VM and skip parsing at startup\n");
+    printf("  --dump-ast                      - Print each line after constant folding and exit\n");
+    printf("  --flush=line|block|exit         - When PRINT output is written: at each newline, every\n");
+    printf("                                    64 KB, or when the program ends (default: line on a\n");
+    printf("                                    terminal, block otherwise)\n");
+    printf("  --profile                       - Time every line, write prog.bas.prof and the\n");
+    printf("                                    collapsed stacks for flame graphs to prog.bas.folded\n");
+    printf("  --sample[=us]                   - Sample the running line and GOSUB stack every 1000 us\n");
+    printf("                                    of CPU time (or us) and write prog.bas.samples\n");
     printf("\nBASIC Syntax:\n");
     printf("  command                         - Execute immediately\n");
     printf("  line_number command             - Add to program (use RUN to execute)\n");
     printf("\nSupported BASIC Commands:\n");
     printf("  PRINT expr [, expr] [; expr]    - Print expressions\n");
     printf("  LET var = expr                  - Assign value to variable\n");
-    printf("  INPUT [prompt;] var             - Input value to variable\n");
+    printf("  INPUT [prompt;] var [, var ...] - Input values, one line or comma-separated fields\n");
+    printf("  DATA item [, item ...]          - Numbers and strings for READ\n");
+    printf("  READ var [, var ...]            - Assign the next DATA items\n");
+    printf("  RESTORE [line_number]           - Read DATA again from the start or that line\n");
     printf("  IF condition THEN statement     - Conditional execution\n");
     printf("  FOR var = start TO end [STEP s] - For loop\n");
     printf("  NEXT [var]                      - End of for loop\n");
     printf("  GOTO line_number                - Jump to line\n");
     printf("  GOSUB line_number               - Call subroutine\n");
+    printf("  ON n GOTO|GOSUB l1 [, l2 ...]   - Jump to or call the nth line\n");
     printf("  RETURN                          - Return from subroutine\n");
     printf("  END                             - End program\n");
+    printf("  DEF FNA(X [, Y ...]) = expr     - Define a one-line function\n");
+    printf("  DIM A(n [, m ...])              - Dimension an array, subscripts run 0..n\n");
+    printf("  MAT C = A + B | A - B | A * B   - Whole-array arithmetic, * is the matrix product\n");
+    printf("  MAT C = (k) * A | TRN(A)        - Scale or transpose an array\n");
+    printf("  MAT A = ZER | CON | IDN [(n,m)] - Fill with zeros, ones or the identity\n");
     printf("  REM comment                     - Comment line\n");
     printf("\nSupported Functions:\n");
     printf("  ABS(x), SIN(x), COS(x), TAN(x), SQR(x)\n");
     printf("  INT(x), RND(), LEN(s$), VAL(s$), STR$(x)\n");
     printf("  CHR$(x), ASC(s$)\n");
-    printf("\nOperators: +, -, *, /, ^, MOD, =, <>, <, <=, >, >=, AND, OR, NOT\n");
+    printf("\nOperators: +, -, *, /, \\ (integer division), ^, MOD, =, <>, <, <=, >, >=, AND, OR, NOT\n");
+    printf("Variables: A (number), A$ (string), A%% (64-bit integer)\n");
     printf("\nSpecial Commands:\n");
     printf("  RUN                             - Run the loaded program\n");
+    printf("  PROFILE                         - Run it and show the time spent per line and command\n");
     printf("  LIST                            - List the program lines\n");
     printf("  VARS                            - Show variables in memory\n");
     printf("  NEW                             - Clear program and variables\n");
@@ -41,7 +74,12 @@ void print_usage() {
 void show_variables(Interpreter *interp) {
     if (!interp) return;
     
-    if (interp->variable_count == 0) {
+    int defined_count = 0;
+    for (int i = 0; i < interp->variable_count; i++) {
+        if (interp->variables[i].defined || interp->variables[i].is_array) defined_count++;
+    }
+
+    if (defined_count == 0) {
         printf("No variables defined\n");
         return;
     }
@@ -49,22 +87,51 @@ void show_variables(Interpreter *interp) {
     printf("Defined variables:\n");
     for (int i = 0; i < interp->variable_count; i++) {
         Variable *var = &interp->variables[i];
+        if (var->is_array) {
+            // arrays show their upper bounds, the way they were dimensioned
+            printf("  %s(", var->name);
+            for (int d = 0; d < var->dimensions; d++) {
+                printf(d > 0 ? ", %d" : "%d", var->dim_sizes[d] - 1);
+            }
+            printf(")\n");
+        }
+        if (!var->defined) continue;
         printf("  %s = ", var->name);
         if (var->value.type == VALUE_NUMBER) {
             printf("%.6g\n", var->value.data.number);
+        } else if (var->value.type == VALUE_INTEGER) {
+            printf("%lld\n", var->value.data.integer);
         } else if (var->value.type == VALUE_STRING && var->value.data.string) {
-            printf("\"%s\"\n", var->value.data.string);
+            printf("\"%s\"\n", var->value.data.string->data);
         } else {
             printf("(undefined)\n");
         }
     }
 }
 
-int is_valid_immediate_command(const char *trimmed) {
+// the report goes to stdout without a report path
+int write_profile(Interpreter *interp, const char *report_path, const char *stacks_path) {
+    FILE *report = report_path ? fopen(report_path, "w") : stdout;
+    FILE *stacks = fopen(stacks_path, "w");
+    if (!report || !stacks) {
+        printf("Cannot write profile to %s\n", !report ? report_path : stacks_path);
+        if (report && report != stdout) fclose(report);
+        if (stacks) fclose(stacks);
+        return 0;
+    }
+
+    write_profile_report(interp, report);
+    write_profile_stacks(interp, stacks);
+    if (report != stdout) fclose(report);
+    fclose(stacks);
+    return 1;
+}
+
+int is_valid_immediate_command(Arena *scratch, const char *trimmed) {
     if (!trimmed) return 0;
     
     int token_count;
-    Token *tokens = tokenize(trimmed, &token_count);
+    Token *tokens = tokenize(scratch, trimmed, &token_count);
     
     if (!tokens || token_count == 0) {
         return 0;
@@ -76,6 +143,7 @@ int is_valid_immediate_command(const char *trimmed) {
             case CMD_PRINT:
             case CMD_LET:
             case CMD_INPUT:
+            case CMD_DIM:
                 valid = 1;
                 break;
             default:
@@ -86,34 +154,61 @@ int is_valid_immediate_command(const char *trimmed) {
         valid = 1;
     }
     
-    cleanup_tokens(tokens, token_count);
     return valid;
 }
 
-void interactive_mode() {
-    Interpreter interp;
-    init_interpreter(&interp);
+void apply_options(Interpreter *interp, const Options *options) {
+    interp->use_vm = options->use_vm;
+    interp->sample_interval = options->sample;
+    set_flush_policy(interp, options->flush);
+}
+
+void interactive_mode(const Options *options) {
+    Interpreter *interp = create_interpreter();
+    if (!interp) {
+        printf("Out of memory\n");
+        return;
+    }
+    apply_options(interp, options);
+
+    // immediate input is validated and tokenized into a scratch arena reset per input line
+    Arena scratch;
+    arena_init(&scratch);
     
     printf("BASIC Interpreter\n");
     printf("Type 'HELP' for commands, 'QUIT' to exit\n\n");
     
-    char input[MAX_LINE_LENGTH];
+    // the line is copied out of the stdin buffer, which INPUT reuses; lines have no length limit
+    char *input = NULL;
+    size_t input_capacity = 0;
     while (1) {
         printf("READY\n");
-        fflush(stdout);
+        flush_output(interp);
         
-        if (!fgets(input, sizeof(input), stdin)) {
+        // commands and INPUT share one reader of stdin
+        size_t length;
+        const char *line = read_input_line(&length);
+        if (!line) {
             break;
         }
-        
-        char *newline = strchr(input, '\n');
-        if (newline) *newline = '\0';
+        if (length + 1 > input_capacity) {
+            char *grown = realloc(input, length + 1);
+            if (!grown) {
+                printf("Out of memory\n");
+                continue;
+            }
+            input = grown;
+            input_capacity = length + 1;
+        }
+        memcpy(input, line, length + 1);
         
         char *trimmed = input;
         while (isspace(*trimmed)) trimmed++;
         if (!*trimmed) continue;
+
+        arena_reset(&scratch);
         
-        strcpy(interp.error_message, "");
+        strcpy(interp->error_message, "");
         
         if (strcasecmp(trimmed, "QUIT") == 0 || strcasecmp(trimmed, "EXIT") == 0) {
             break;
@@ -121,40 +216,61 @@ void interactive_mode() {
             print_usage();
             continue;
         } else if (strcasecmp(trimmed, "RUN") == 0) {
-            if (interp.line_count == 0) {
+            if (interp->line_count == 0) {
                 printf("No program loaded. Use line numbers to add program lines.\n");
                 continue;
             }
 
             printf("Running program...\n");
-            if (!execute_program(&interp)) {
-                if (strlen(interp.error_message) == 0) {
+            if (!execute_program(interp)) {
+                if (strlen(interp->error_message) == 0) {
                     printf("Program execution failed\n");
                 }
             }
             continue;
+        } else if (strcasecmp(trimmed, "PROFILE") == 0) {
+            if (interp->line_count == 0) {
+                printf("No program loaded. Use line numbers to add program lines.\n");
+                continue;
+            }
+
+            printf("Profiling program...\n");
+            interp->profiling = 1;
+            if (!execute_program(interp) && strlen(interp->error_message) == 0) {
+                printf("Program execution failed\n");
+            }
+            interp->profiling = 0;
+            if (interp->profile && write_profile(interp, NULL, "basic.folded")) {
+                printf("Collapsed stacks written to basic.folded\n");
+            }
+            continue;
         } else if (strcasecmp(trimmed, "LIST") == 0) {
-            if (interp.line_count == 0) {
+            if (interp->line_count == 0) {
                 printf("No program loaded\n");
             } else {
-                for (int i = 0; i < interp.line_count; i++) {
-                    printf("%d %s\n", interp.lines[i].line_number, 
-                           interp.lines[i].text ? interp.lines[i].text : "");
+                for (int i = 0; i < interp->line_count; i++) {
+                    const Line *line = get_line(interp, i);
+                    printf("%d %s\n", line->line_number, line->text ? line->text : "");
                 }
             }
             continue;
         } else if (strcasecmp(trimmed, "VARS") == 0) {
-            show_variables(&interp);
+            show_variables(interp);
             continue;
         } else if (strcasecmp(trimmed, "NEW") == 0) {
-            cleanup_interpreter(&interp);
-            init_interpreter(&interp);
+            destroy_interpreter(interp);
+            interp = create_interpreter();
+            if (!interp) {
+                printf("Out of memory\n");
+                break;
+            }
+            apply_options(interp, options);
             printf("Program cleared\n");
             continue;
         } else if (strncasecmp(trimmed, "DEBUG ", 6) == 0) {
             char *expr = trimmed + 6;
             int token_count;
-            Token *tokens = tokenize(expr, &token_count);
+            Token *tokens = tokenize(&scratch, expr, &token_count);
             if (tokens && token_count > 0) {
                 printf("Tokenization of '%s':\n", expr);
                 for (int i = 0; i < token_count; i++) {
@@ -171,7 +287,6 @@ void interactive_mode() {
                     }
                     printf(" Text: '%s'\n", tokens[i].text ? tokens[i].text : "NULL");
                 }
-                cleanup_tokens(tokens, token_count);
             } else {
                 printf("Failed to tokenize expression\n");
             }
@@ -179,16 +294,21 @@ void interactive_mode() {
         }
         
         if (!isdigit(trimmed[0])) {
-            if (is_valid_immediate_command(trimmed)) {
+            if (is_valid_immediate_command(&scratch, trimmed)) {
+                // the statement lives in the scratch arena until the next line, the
+                // literals it stored in variables are copied out before then
                 int token_count;
-                Token *tokens = tokenize(trimmed, &token_count);
-                if (tokens && token_count > 0) {
-                    if (!execute_line_tokens(&interp, tokens, token_count, 0)) {
-                        if (strlen(interp.error_message) == 0) {
+                Token *tokens = tokenize(&scratch, trimmed, &token_count);
+                Statement *stmt = tokens && token_count > 0 ? parse_statement(interp, &scratch, tokens, token_count) : NULL;
+                if (stmt) {
+                    int ok = execute_statement(interp, stmt);
+                    ok = keep_strings(interp, &scratch) && ok;
+                    flush_output(interp);
+                    if (!ok) {
+                        if (strlen(interp->error_message) == 0) {
                             printf("Error executing command\n");
                         }
                     }
-                    cleanup_tokens(tokens, token_count);
                 } else {
                     printf("Syntax error\n");
                 }
@@ -197,63 +317,169 @@ void interactive_mode() {
                 printf("Type 'HELP' for available commands\n");
             }
         } else {
-            if (!parse_line(&interp, trimmed)) {
-                if (strlen(interp.error_message) == 0) {
+            if (!parse_line(interp, trimmed)) {
+                if (strlen(interp->error_message) == 0) {
                     printf("Syntax error\n");
                 }
-                continue;
-            }
-            
-            for (int i = 0; i < interp.line_count - 1; i++) {
-                for (int j = i + 1; j < interp.line_count; j++) {
-                    if (interp.lines[i].line_number > interp.lines[j].line_number) {
-                        Line temp = interp.lines[i];
-                        interp.lines[i] = interp.lines[j];
-                        interp.lines[j] = temp;
-                    }
-                }
             }
         }
     }
     
-    cleanup_interpreter(&interp);
+    free(input);
+    arena_free(&scratch);
+    destroy_interpreter(interp);
+}
+
+int compile_image(Interpreter *interp, const Options *options, int is_image) {
+    if (is_image) {
+        printf("%s is already a program image\n", options->filename);
+        return 0;
+    }
+
+    char image_path[1024];
+    if (snprintf(image_path, sizeof(image_path), "%sc", options->filename) >= (int)sizeof(image_path)) {
+        printf("File name too long\n");
+        return 0;
+    }
+    if (!write_program_image(interp, image_path, options->filename)) {
+        return 0;
+    }
+    printf("Program compiled to %s\n", image_path);
+    return 1;
+}
+
+// --profile: prog.bas.prof and prog.bas.folded next to the program
+int write_profile_files(Interpreter *interp, const char *filename) {
+    char report_path[1024];
+    char stacks_path[1024];
+    if (snprintf(report_path, sizeof(report_path), "%s.prof", filename) >= (int)sizeof(report_path) ||
+        snprintf(stacks_path, sizeof(stacks_path), "%s.folded", filename) >= (int)sizeof(stacks_path)) {
+        printf("File name too long\n");
+        return 0;
+    }
+    if (!write_profile(interp, report_path, stacks_path)) {
+        return 0;
+    }
+    printf("Profile written to %s and %s\n", report_path, stacks_path);
+    return 1;
+}
+
+// --sample: prog.bas.samples next to the program
+int write_sample_file(Interpreter *interp, const char *filename) {
+    char path[1024];
+    if (snprintf(path, sizeof(path), "%s.samples", filename) >= (int)sizeof(path)) {
+        printf("File name too long\n");
+        return 0;
+    }
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        printf("Cannot write samples to %s\n", path);
+        return 0;
+    }
+    write_sample_report(interp, out);
+    fclose(out);
+    printf("Samples written to %s\n", path);
+    return 1;
 }
 
 int main(int argc, char** argv) {
     srand((unsigned int)time(NULL));
     
-    if (argc == 1) {
-        interactive_mode();
+    Options options = {0, 0, 0, FLUSH_AUTO, 0, 0, NULL};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--vm") == 0) {
+            options.use_vm = 1;
+        } else if (strcmp(argv[i], "--compile") == 0) {
+            options.compile = 1;
+        } else if (strcmp(argv[i], "--dump-ast") == 0) {
+            options.dump_ast = 1;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            options.profile = 1;
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            options.sample = SAMPLE_INTERVAL;
+        } else if (strncmp(argv[i], "--sample=", 9) == 0) {
+            char *end;
+            const long interval = strtol(argv[i] + 9, &end, 10);
+            if (*end || interval <= 0 || interval > 1000000) {
+                print_usage();
+                return 1;
+            }
+            options.sample = (int)interval;
+        } else if (strcmp(argv[i], "--flush=line") == 0) {
+            options.flush = FLUSH_LINE;
+        } else if (strcmp(argv[i], "--flush=block") == 0) {
+            options.flush = FLUSH_BLOCK;
+        } else if (strcmp(argv[i], "--flush=exit") == 0) {
+            options.flush = FLUSH_EXIT;
+        } else if (argv[i][0] == '-' || options.filename) {
+            print_usage();
+            return 1;
+        } else {
+            options.filename = argv[i];
+        }
+    }
+
+    if (!options.filename) {
+        if (options.compile || options.dump_ast) {
+            print_usage();
+            return 1;
+        }
+        interactive_mode(&options);
         return 0;
     }
     
-    if (argc != 2) {
-        print_usage();
+    Interpreter *interp = create_interpreter();
+    if (!interp) {
+        printf("Out of memory\n");
         return 1;
     }
+    apply_options(interp, &options);
     
-    Interpreter interp;
-    init_interpreter(&interp);
-    
-    printf("Loading BASIC program: %s\n", argv[1]);
-    if (!load_program(&interp, argv[1])) {
+    printf("Loading BASIC program: %s\n", options.filename);
+    const int is_image = is_program_image(options.filename);
+    const int loaded = is_image ? load_program_image(interp, options.filename) : load_program(interp, options.filename);
+    if (!loaded) {
         printf("Failed to load program\n");
-        cleanup_interpreter(&interp);
+        destroy_interpreter(interp);
         return 1;
     }
+
+    if (options.dump_ast) {
+        if (is_image) {
+            printf("%s is a program image, dump its source instead\n", options.filename);
+            destroy_interpreter(interp);
+            return 1;
+        }
+        dump_program(interp, stdout);
+        destroy_interpreter(interp);
+        return 0;
+    }
+
+    if (options.compile) {
+        const int compiled = compile_image(interp, &options, is_image);
+        destroy_interpreter(interp);
+        return compiled ? 0 : 1;
+    }
     
-    printf("Program loaded successfully. %d lines.\n", interp.line_count);
+    printf("Program loaded successfully. %d lines.\n", interp->line_count);
     printf("Running program...\n\n");
     
-    if (!execute_program(&interp)) {
-        if (strlen(interp.error_message) == 0) {
-            printf("Program execution failed\n");
-        }
-        cleanup_interpreter(&interp);
-        return 1;
+    interp->profiling = options.profile;
+    const int ok = execute_program(interp);
+    if (!ok && strlen(interp->error_message) == 0) {
+        printf("Program execution failed\n");
     }
-    
-    printf("\nProgram execution completed.\n");
-    cleanup_interpreter(&interp);
-    return 0;
+    if (ok) {
+        printf("\nProgram execution completed.\n");
+    }
+
+    // a failed run still has the times of the lines it ran
+    if (options.profile && interp->profile) {
+        write_profile_files(interp, options.filename);
+    }
+    if (options.sample && interp->samples) {
+        write_sample_file(interp, options.filename);
+    }
+    destroy_interpreter(interp);
+    return ok ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "interpreter/basic_interpreter.h"
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGNMENT 8
+
+void arena_init(Arena *arena) {
+    if (!arena) return;
+
+    arena->head = NULL;
+    arena->current = NULL;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    if (!arena) return NULL;
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (size == 0) size = ARENA_ALIGNMENT;
+
+    ArenaChunk *chunk = arena->current;
+    if (chunk && chunk->size - chunk->used >= size) {
+        void *ptr = chunk->data + chunk->used;
+        chunk->used += size;
+        return ptr;
+    }
+
+    // chunks kept by arena_reset() are reused before new ones are allocated
+    while (chunk && chunk->next) {
+        chunk = chunk->next;
+        chunk->used = 0;
+        if (chunk->size >= size) {
+            arena->current = chunk;
+            chunk->used = size;
+            return chunk->data;
+        }
+    }
+
+    const size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    ArenaChunk *fresh = malloc(sizeof(ArenaChunk) + chunk_size);
+    if (!fresh) return NULL;
+    fresh->size = chunk_size;
+    fresh->used = size;
+    fresh->next = NULL;
+
+    if (chunk) {
+        chunk->next = fresh;
+    } else {
+        arena->head = fresh;
+    }
+    arena->current = fresh;
+    return fresh->data;
+}
+
+char *arena_strndup(Arena *arena, const char *text, size_t length) {
+    char *copy = arena_alloc(arena, length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+// moves every chunk of source into arena, whose allocations live on untouched;
+// the chunks are linked in front so arena_alloc() never treats them as free
+void arena_adopt(Arena *arena, Arena *source) {
+    if (!arena || !source || !source->head) return;
+
+    ArenaChunk *last = source->head;
+    while (last->next) last = last->next;
+
+    last->next = arena->head;
+    arena->head = source->head;
+    if (!arena->current) {
+        arena->current = last;
+    }
+
+    source->head = NULL;
+    source->current = NULL;
+}
+
+// true when ptr lies in one of the arena's chunks, used or rewound
+int arena_owns(const Arena *arena, const void *ptr) {
+    const char *address = ptr;
+    for (const ArenaChunk *chunk = arena->head; chunk; chunk = chunk->next) {
+        if (address >= chunk->data && address < chunk->data + chunk->size) return 1;
+    }
+    return 0;
+}
+
+void arena_reset(Arena *arena) {
+    if (!arena) return;
+
+    // O(1): chunks stay allocated and are rewound lazily as they are reused
+    arena->current = arena->head;
+    if (arena->current) {
+        arena->current->used = 0;
+    }
+}
+
+void arena_free(Arena *arena) {
+    if (!arena) return;
+
+    ArenaChunk *chunk = arena->head;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+}
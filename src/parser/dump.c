@@ -0,0 +1,219 @@
+#include "interpreter/basic_interpreter.h"
+
+// names indexed by the enums in basic_interpreter.h
+static const char *command_names[] = {
+    "PRINT", "LET", "INPUT", "IF", "THEN", "ELSE", "GOTO", "GOSUB", "RETURN",
+    "FOR", "TO", "STEP", "NEXT", "END", "REM", "DATA", "READ", "RESTORE",
+    "DIM", "MAT", "DEF", "ON", "STOP", "RUN", "LIST", "NEW", "CLEAR", "?"
+};
+
+static const char *operator_names[] = {
+    "+", "-", "*", "/", "\\", "^", "MOD", "=", "<>", "<", "<=", ">", ">=",
+    "AND", "OR", "NOT", "=", "?"
+};
+
+static const char *function_names[] = {
+    "ABS", "SIN", "COS", "TAN", "SQR", "INT", "RND", "LEN", "LEFT$",
+    "RIGHT$", "MID$", "VAL", "STR$", "CHR$", "ASC", "?"
+};
+
+static const char *matrix_names[] = {
+    "", "+", "-", "*", "*", "ZER", "CON", "IDN", "TRN"
+};
+
+static void dump_string(FILE *out, const String *string) {
+    fputc('"', out);
+    for (size_t i = 0; string && i < string->length; i++) {
+        const unsigned char c = (unsigned char)string->data[i];
+        switch (c) {
+            case '\n': fputs("\\n", out); break;
+            case '\t': fputs("\\t", out); break;
+            case '"': fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            default:
+                if (c < 32 || c == 127) {
+                    fprintf(out, "\\x%02x", c);
+                } else {
+                    fputc(c, out);
+                }
+                break;
+        }
+    }
+    fputc('"', out);
+}
+
+// prints an expression fully parenthesized so the tree shape is visible
+static void dump_node(FILE *out, const Node *node) {
+    if (!node) {
+        fputs("?", out);
+        return;
+    }
+
+    switch (node->type) {
+        case NODE_NUMBER:
+            if (node->value.type == VALUE_INTEGER) {
+                fprintf(out, "%lld%%", node->value.data.integer); // integer constant
+            } else {
+                fprintf(out, "%.17g", node->value.data.number);
+            }
+            break;
+        case NODE_STRING:
+            dump_string(out, node->value.data.string);
+            break;
+        case NODE_VARIABLE:
+        case NODE_PARAM:
+            fputs(node->name ? node->name : "?", out);
+            break;
+        case NODE_UNARY:
+            fprintf(out, node->op == OP_NOT ? "(NOT " : "(%s", operator_names[node->op]);
+            dump_node(out, node->left);
+            fputc(')', out);
+            break;
+        case NODE_BINARY:
+            fputc('(', out);
+            dump_node(out, node->left);
+            fprintf(out, " %s ", operator_names[node->op]);
+            dump_node(out, node->right);
+            fputc(')', out);
+            break;
+        case NODE_FUNCTION:
+        case NODE_ARRAY:
+        case NODE_FN_CALL:
+            fprintf(out, "%s(", node->type == NODE_FUNCTION ? function_names[node->function] : node->name);
+            for (int i = 0; i < node->arg_count; i++) {
+                if (i > 0) fputs(", ", out);
+                dump_node(out, node->args[i]);
+            }
+            fputc(')', out);
+            break;
+    }
+}
+
+static void dump_statement(FILE *out, const Statement *stmt) {
+    if (stmt->error) {
+        fprintf(out, "<%s>", stmt->error);
+        return;
+    }
+
+    fputs(command_names[stmt->command], out);
+    switch (stmt->command) {
+        case CMD_PRINT:
+            for (int i = 0; i < stmt->item_count; i++) {
+                fputc(' ', out);
+                if (stmt->items[i].expr) dump_node(out, stmt->items[i].expr);
+                if (stmt->items[i].separator) fputc(stmt->items[i].separator, out);
+            }
+            break;
+        case CMD_LET:
+            fputc(' ', out);
+            dump_node(out, stmt->target);
+            fputs(" = ", out);
+            dump_node(out, stmt->expr);
+            if (stmt->operand_count > 0) {
+                fprintf(out, " [append %d]", stmt->operand_count);
+            }
+            break;
+        case CMD_INPUT:
+            if (stmt->prompt) fprintf(out, " \"%s\";", stmt->prompt);
+            for (int i = 0; i < stmt->operand_count; i++) {
+                fputs(i > 0 ? ", " : " ", out);
+                dump_node(out, stmt->operands[i]);
+            }
+            break;
+        case CMD_IF:
+            fputc(' ', out);
+            dump_node(out, stmt->expr);
+            fputs(" THEN ", out);
+            if (stmt->then_statement) {
+                dump_statement(out, stmt->then_statement);
+            } else {
+                fprintf(out, "%d", stmt->target_line);
+            }
+            break;
+        case CMD_FOR:
+            fputc(' ', out);
+            dump_node(out, stmt->target);
+            fputs(" = ", out);
+            dump_node(out, stmt->expr);
+            fputs(" TO ", out);
+            dump_node(out, stmt->end_expr);
+            if (stmt->step_expr) {
+                fputs(" STEP ", out);
+                dump_node(out, stmt->step_expr);
+            }
+            break;
+        case CMD_DIM:
+            for (int i = 0; i < stmt->operand_count; i++) {
+                fputs(i > 0 ? ", " : " ", out);
+                dump_node(out, stmt->operands[i]);
+            }
+            break;
+        case CMD_MAT:
+            fprintf(out, " %s = ", stmt->target->name);
+            if (stmt->mat_op == MAT_SCALE) {
+                dump_node(out, stmt->expr);
+                fputs(" * ", out);
+            } else if (stmt->mat_op >= MAT_ZER) {
+                fputs(matrix_names[stmt->mat_op], out);
+                if (stmt->target->type == NODE_ARRAY) {
+                    fputc('(', out);
+                    for (int i = 0; i < stmt->target->arg_count; i++) {
+                        if (i > 0) fputs(", ", out);
+                        dump_node(out, stmt->target->args[i]);
+                    }
+                    fputc(')', out);
+                }
+                if (stmt->mat_op != MAT_TRN) break;
+                fputc('(', out);
+            }
+            for (int i = 0; i < stmt->operand_count; i++) {
+                if (i > 0) fprintf(out, " %s ", matrix_names[stmt->mat_op]);
+                dump_node(out, stmt->operands[i]);
+            }
+            if (stmt->mat_op == MAT_TRN) fputc(')', out);
+            break;
+        case CMD_DEF:
+            fputc(' ', out);
+            dump_node(out, stmt->target);
+            fputs(" = ", out);
+            dump_node(out, stmt->expr);
+            break;
+        case CMD_READ:
+            for (int i = 0; i < stmt->operand_count; i++) {
+                fputs(i > 0 ? ", " : " ", out);
+                dump_node(out, stmt->operands[i]);
+            }
+            break;
+        case CMD_GOTO:
+        case CMD_GOSUB:
+            fprintf(out, " %d", stmt->target_line);
+            break;
+        case CMD_ON:
+            fputc(' ', out);
+            dump_node(out, stmt->expr);
+            fprintf(out, " %s", command_names[stmt->on_command]);
+            for (int i = 0; i < stmt->target_count; i++) {
+                fprintf(out, "%s%d", i > 0 ? ", " : " ", stmt->target_lines[i]);
+            }
+            break;
+        case CMD_RESTORE:
+            if (stmt->target_line >= 0) fprintf(out, " %d", stmt->target_line);
+            break;
+        default:
+            break;
+    }
+}
+
+const char *command_name(Command command) {
+    return command_names[command];
+}
+
+// prints every line the way it will run, after constant folding
+void dump_program(Interpreter *interp, FILE *out) {
+    for (int i = 0; i < interp->line_count; i++) {
+        const Line *line = get_line(interp, i);
+        fprintf(out, "%d ", line->line_number);
+        if (line->statement) dump_statement(out, line->statement);
+        fputc('\n', out);
+    }
+}
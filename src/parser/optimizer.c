@@ -0,0 +1,276 @@
+#include "interpreter/basic_interpreter.h"
+#include <math.h>
+
+static int is_constant(const Node *node) {
+    return node && (node->type == NODE_NUMBER || node->type == NODE_STRING);
+}
+
+static int is_number(const Node *node, double number) {
+    if (node->type != NODE_NUMBER) return 0;
+    if (node->value.type == VALUE_INTEGER) return node->value.data.integer == (long long)number;
+    return node->value.data.number == number && !signbit(node->value.data.number);
+}
+
+// true when the node can only produce an integer: A% variables and integer operations on them
+static int is_integer(const Node *node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return node->value.type == VALUE_INTEGER;
+        case NODE_VARIABLE:
+        case NODE_ARRAY:
+        case NODE_PARAM:
+        case NODE_FN_CALL:
+            return is_integer_name(node->name);
+        case NODE_UNARY:
+            return is_integer(node->left);
+        case NODE_BINARY:
+            switch (node->op) {
+                case OP_INT_DIVIDE:
+                    return 1;
+                case OP_PLUS:
+                case OP_MINUS:
+                case OP_MULTIPLY:
+                case OP_MOD:
+                case OP_AND:
+                case OP_OR:
+                    return is_integer(node->left) && is_integer(node->right);
+                default:
+                    return 0;
+            }
+        default:
+            return 0;
+    }
+}
+
+static int is_string_name(const char *name) {
+    return name[strlen(name) - 1] == '$';
+}
+
+// true when the node can only produce a number, an integer or not; A% variables and arrays are typed
+static int is_numeric(const Node *node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+        case NODE_UNARY:
+            return 1;
+        case NODE_VARIABLE:
+        case NODE_PARAM:
+        case NODE_FN_CALL:
+            return is_integer_name(node->name);
+        case NODE_ARRAY:
+            return !is_string_name(node->name);
+        case NODE_BINARY:
+            // + is the only operator that also concatenates
+            return node->op != OP_PLUS || (is_numeric(node->left) && is_numeric(node->right));
+        case NODE_FUNCTION:
+            switch (node->function) {
+                case FUNC_STR:
+                case FUNC_CHR:
+                case FUNC_LEFT:
+                case FUNC_RIGHT:
+                case FUNC_MID:
+                case FUNC_UNKNOWN:
+                    return 0;
+                default:
+                    return 1;
+            }
+        default:
+            return 0;
+    }
+}
+
+// true when the node produces a number that is never an integer
+static int is_float(const Node *node) {
+    switch (node->type) {
+        case NODE_NUMBER:
+            return node->value.type == VALUE_NUMBER;
+        case NODE_FUNCTION:
+            return is_numeric(node);
+        case NODE_ARRAY:
+            return !is_string_name(node->name) && !is_integer_name(node->name);
+        case NODE_BINARY:
+            return node->op == OP_DIVIDE || node->op == OP_POWER ||
+                   (node->op >= OP_EQUAL && node->op <= OP_GREATER_EQUAL);
+        default:
+            return 0;
+    }
+}
+
+// operators whose integer form cannot overflow: comparisons, AND, OR, MOD,
+// and \, which converts number operands to integers anyway. + - and * keep
+// their literals as numbers, I% * 2 computes in doubles like I% * B does
+static int promotes_literals(Operator op) {
+    switch (op) {
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+        case OP_AND:
+        case OP_OR:
+        case OP_MOD:
+        case OP_INT_DIVIDE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// a whole literal beside an integer operand becomes an integer constant, so
+// I% < 10 compares integers instead of converting I% to a number
+static void integer_literal(Node *node, const Node *other) {
+    if (node->type != NODE_NUMBER || node->value.type != VALUE_NUMBER || !is_integer(other)) return;
+
+    const double number = node->value.data.number;
+    if (number == floor(number) && number >= (double)LLONG_MIN && number < -(double)LLONG_MIN) {
+        node->value = create_integer_value((long long)number);
+    }
+}
+
+// turns the node into a literal; string results move into the arena like tokenizer literals
+static int fold_node(Arena *arena, Node *node, Value value) {
+    if (value.type == VALUE_STRING) {
+        if (!value.data.string) return 0;
+        const size_t length = value.data.string->length;
+        String *string = arena_alloc(arena, sizeof(String) + length + 1);
+        if (!string) {
+            cleanup_value(&value);
+            return 0;
+        }
+        string->refcount = STRING_IMMORTAL;
+        string->length = length;
+        string->capacity = length;
+        memcpy(string->data, value.data.string->data, length + 1);
+        cleanup_value(&value);
+        value.type = VALUE_STRING;
+        value.data.string = string;
+        node->type = NODE_STRING;
+    } else {
+        node->type = NODE_NUMBER;
+    }
+
+    node->value = value;
+    node->left = NULL;
+    node->right = NULL;
+    node->args = NULL;
+    node->arg_count = 0;
+    return 1;
+}
+
+// evaluates a constant node once; anything that fails is left for the program to report when it runs
+static void try_fold(Interpreter *interp, Arena *arena, Node *node) {
+    char saved_error[sizeof(interp->error_message)];
+    strcpy(saved_error, interp->error_message);
+    interp->error_message[0] = '\0';
+    interp->quiet_errors = 1;
+
+    Value value = evaluate_node(interp, node);
+    const int failed = strlen(interp->error_message) > 0;
+
+    interp->quiet_errors = 0;
+    strcpy(interp->error_message, saved_error);
+
+    if (failed) {
+        cleanup_value(&value);
+        return;
+    }
+    fold_node(arena, node, value);
+}
+
+static void replace_node(Node *node, const Node *with) {
+    *node = *with;
+}
+
+static void optimize_node(Interpreter *interp, Arena *arena, Node *node) {
+    if (!node) return;
+
+    switch (node->type) {
+        case NODE_UNARY:
+            optimize_node(interp, arena, node->left);
+            if (is_constant(node->left)) {
+                try_fold(interp, arena, node);
+            }
+            break;
+
+        case NODE_BINARY:
+            optimize_node(interp, arena, node->left);
+            optimize_node(interp, arena, node->right);
+            if (promotes_literals(node->op)) {
+                integer_literal(node->left, node->right);
+                integer_literal(node->right, node->left);
+            }
+            if (is_constant(node->left) && is_constant(node->right)) {
+                try_fold(interp, arena, node);
+                break;
+            }
+
+            // only identities that are exact in IEEE arithmetic and keep the type of x;
+            // x+0 turns -0 into 0 and x/1 turns an integer into a number
+            switch (node->op) {
+                case OP_MULTIPLY:
+                    if (is_number(node->right, 1) && is_numeric(node->left)) {
+                        replace_node(node, node->left);
+                    } else if (is_number(node->left, 1) && is_numeric(node->right)) {
+                        replace_node(node, node->right);
+                    }
+                    break;
+                case OP_DIVIDE:
+                case OP_POWER:
+                    if (is_number(node->right, 1) && is_float(node->left)) {
+                        replace_node(node, node->left);
+                    }
+                    break;
+                case OP_MINUS:
+                    if (is_number(node->right, 0) && is_numeric(node->left)) {
+                        replace_node(node, node->left);
+                    }
+                    break;
+                default:
+                    break;
+            }
+            break;
+
+        case NODE_ARRAY:
+        case NODE_FN_CALL:
+            for (int i = 0; i < node->arg_count; i++) {
+                optimize_node(interp, arena, node->args[i]);
+            }
+            break;
+
+        case NODE_FUNCTION: {
+            int constant_args = 1;
+            for (int i = 0; i < node->arg_count; i++) {
+                optimize_node(interp, arena, node->args[i]);
+                if (!is_constant(node->args[i])) constant_args = 0;
+            }
+            // RND is the only built-in that is not pure
+            if (constant_args && node->function != FUNC_RND) {
+                try_fold(interp, arena, node);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+// folds constant subexpressions in place, so node pointers held by the statement stay valid
+void optimize_statement(Interpreter *interp, Arena *arena, Statement *stmt) {
+    for (; stmt; stmt = stmt->then_statement) {
+        if (stmt->error) return;
+
+        optimize_node(interp, arena, stmt->target);
+        optimize_node(interp, arena, stmt->expr);
+        optimize_node(interp, arena, stmt->end_expr);
+        optimize_node(interp, arena, stmt->step_expr);
+        for (int i = 0; i < stmt->item_count; i++) {
+            optimize_node(interp, arena, stmt->items[i].expr);
+        }
+        if (stmt->command == CMD_DIM) {
+            for (int i = 0; i < stmt->operand_count; i++) {
+                optimize_node(interp, arena, stmt->operands[i]);
+            }
+        }
+    }
+}
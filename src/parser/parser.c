@@ -0,0 +1,820 @@
+#include "interpreter/basic_interpreter.h"
+
+#define UNARY_PRECEDENCE 7
+
+typedef struct parser_t {
+    Interpreter *interp;
+    Arena *arena;
+    Token *tokens;
+    int count;
+    int pos;
+    const char *error;
+    Node **params; // while parsing a DEF FN body, its parameters
+    int param_count;
+} Parser;
+
+int get_precedence(const Operator op) {
+    switch (op) {
+        case OP_OR:
+            return 1;
+        case OP_AND:
+            return 2;
+        case OP_NOT:
+            return 3;
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+        case OP_LESS:
+        case OP_LESS_EQUAL:
+        case OP_GREATER:
+        case OP_GREATER_EQUAL:
+            return 4;
+        case OP_PLUS:
+        case OP_MINUS:
+            return 5;
+        case OP_MULTIPLY:
+        case OP_DIVIDE:
+        case OP_INT_DIVIDE:
+        case OP_MOD:
+            return 6;
+        case OP_POWER:
+            return 7;
+        case OP_ASSIGN:
+        case OP_UNKNOWN:
+        default:
+            return 0;
+    }
+}
+
+static Token *peek(Parser *p) {
+    return p->pos < p->count ? &p->tokens[p->pos] : NULL;
+}
+
+static int at_delimiter(Parser *p, char c) {
+    const Token *token = peek(p);
+    return token && token->type == TOKEN_DELIMITER && token->text && token->text[0] == c;
+}
+
+static int at_operator(Parser *p, Operator op) {
+    const Token *token = peek(p);
+    return token && token->type == TOKEN_OPERATOR && token->operator == op;
+}
+
+static int at_command(Parser *p, Command cmd) {
+    const Token *token = peek(p);
+    return token && token->type == TOKEN_COMMAND && token->command == cmd;
+}
+
+static int fail(Parser *p, const char *message) {
+    if (!p->error) p->error = message;
+    return 0;
+}
+
+// statement trees live in the program arena and are released with it
+static void *parser_alloc(Parser *p, size_t size) {
+    void *ptr = arena_alloc(p->arena, size);
+    if (!ptr) {
+        fail(p, "Memory allocation failed");
+        return NULL;
+    }
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+static Node *new_node(Parser *p, NodeType type) {
+    Node *node = parser_alloc(p, sizeof(Node));
+    if (!node) return NULL;
+    node->type = type;
+    node->value = create_number_value(0);
+    node->op = OP_UNKNOWN;
+    node->function = FUNC_UNKNOWN;
+    return node;
+}
+
+static Node *parse_expression(Parser *p, int min_precedence);
+
+// the comma-separated list after '(' of a function call or an array subscript
+static Node *parse_arguments(Parser *p, Node *node, int max_count, const char *too_many, const char *unclosed) {
+    if (at_delimiter(p, ')')) {
+        p->pos++;
+        return node;
+    }
+
+    Node *args[MAX_FUNCTION_ARGS > MAX_ARRAY_DIMENSIONS ? MAX_FUNCTION_ARGS : MAX_ARRAY_DIMENSIONS];
+    while (1) {
+        if (node->arg_count >= max_count) {
+            fail(p, too_many);
+            return NULL;
+        }
+        Node *arg = parse_expression(p, 1);
+        if (!arg) return NULL;
+        args[node->arg_count++] = arg;
+
+        if (at_delimiter(p, ',')) {
+            p->pos++;
+            continue;
+        }
+        if (at_delimiter(p, ')')) {
+            p->pos++;
+            break;
+        }
+        fail(p, unclosed);
+        return NULL;
+    }
+
+    node->args = parser_alloc(p, sizeof(Node *) * node->arg_count);
+    if (!node->args) return NULL;
+    memcpy(node->args, args, sizeof(Node *) * node->arg_count);
+    return node;
+}
+
+static Node *parse_function_call(Parser *p, const Token *token) {
+    Node *node = new_node(p, NODE_FUNCTION);
+    if (!node) return NULL;
+    node->function = token->function;
+
+    if (!at_delimiter(p, '(')) {
+        // RND may be used without parentheses
+        if (token->function == FUNC_RND) return node;
+        fail(p, "Function call requires parentheses");
+        return NULL;
+    }
+    p->pos++;
+
+    return parse_arguments(p, node, MAX_FUNCTION_ARGS, "Too many function arguments",
+                           "Missing closing parenthesis in function call");
+}
+
+// FNA(x, y), or FNA for a function without parameters
+static Node *parse_user_call(Parser *p, const Token *token) {
+    Node *node = new_node(p, NODE_FN_CALL);
+    if (!node) return NULL;
+    node->name = token->text;
+    node->slot = resolve_function(p->interp, token->text);
+    if (node->slot == -1) {
+        fail(p, "Out of memory");
+        return NULL;
+    }
+
+    if (!at_delimiter(p, '(')) return node;
+    p->pos++;
+    return parse_arguments(p, node, MAX_FUNCTION_ARGS, "Too many function arguments",
+                           "Missing closing parenthesis in function call");
+}
+
+static Node *parse_primary(Parser *p) {
+    Token *token = peek(p);
+    if (!token) {
+        fail(p, "Invalid expression");
+        return NULL;
+    }
+
+    switch (token->type) {
+        case TOKEN_NUMBER: {
+            p->pos++;
+            Node *node = new_node(p, NODE_NUMBER);
+            if (node) node->value = create_number_value(token->value.data.number);
+            return node;
+        }
+        case TOKEN_STRING: {
+            p->pos++;
+            Node *node = new_node(p, NODE_STRING);
+            if (!node) return NULL;
+            // shares the arena-owned literal with the token
+            node->value.type = VALUE_STRING;
+            node->value.data.string = token->value.data.string;
+            return node;
+        }
+        case TOKEN_VARIABLE: {
+            p->pos++;
+            // inside a DEF FN body the parameters shadow variables of the same name
+            for (int i = 0; i < p->param_count; i++) {
+                if (strcasecmp(p->params[i]->name, token->text) == 0 && !at_delimiter(p, '(')) {
+                    Node *param = new_node(p, NODE_PARAM);
+                    if (!param) return NULL;
+                    param->name = token->text;
+                    param->slot = i;
+                    return param;
+                }
+            }
+            if (is_function_name(token->text)) {
+                return parse_user_call(p, token);
+            }
+
+            Node *node = new_node(p, NODE_VARIABLE);
+            if (!node) return NULL;
+            node->name = token->text;
+            // names are resolved to slots once, execution indexes interp->variables directly
+            node->slot = resolve_variable(p->interp, node->name);
+            if (node->slot == -1) {
+                fail(p, "Out of memory");
+                return NULL;
+            }
+            if (at_delimiter(p, '(')) {
+                p->pos++;
+                node->type = NODE_ARRAY;
+                return parse_arguments(p, node, MAX_ARRAY_DIMENSIONS, "Too many subscripts",
+                                       "Missing closing parenthesis in subscript");
+            }
+            return node;
+        }
+        case TOKEN_FUNCTION:
+            p->pos++;
+            return parse_function_call(p, token);
+        case TOKEN_DELIMITER:
+            if (at_delimiter(p, '(')) {
+                p->pos++;
+                Node *inner = parse_expression(p, 1);
+                if (!inner) return NULL;
+                if (!at_delimiter(p, ')')) {
+                    fail(p, "Missing closing parenthesis");
+                    return NULL;
+                }
+                p->pos++;
+                return inner;
+            }
+            break;
+        default:
+            break;
+    }
+
+    fail(p, "Invalid expression");
+    return NULL;
+}
+
+// precedence climbing over get_precedence(); all binary operators are left-associative
+static Node *parse_expression(Parser *p, int min_precedence) {
+    Node *left = NULL;
+    Token *token = peek(p);
+
+    if (token && token->type == TOKEN_OPERATOR &&
+        (token->operator == OP_NOT || token->operator == OP_MINUS || token->operator == OP_PLUS)) {
+        p->pos++;
+        const int operand_precedence = token->operator == OP_NOT ? get_precedence(OP_NOT) : UNARY_PRECEDENCE;
+        Node *operand = parse_expression(p, operand_precedence);
+        if (!operand) return NULL;
+        left = new_node(p, NODE_UNARY);
+        if (!left) return NULL;
+        left->op = token->operator;
+        left->left = operand;
+    } else {
+        left = parse_primary(p);
+        if (!left) return NULL;
+    }
+
+    while ((token = peek(p)) && token->type == TOKEN_OPERATOR && token->operator != OP_NOT) {
+        const int precedence = get_precedence(token->operator);
+        if (precedence == 0 || precedence < min_precedence) break;
+        p->pos++;
+
+        Node *right = parse_expression(p, precedence + 1);
+        if (!right) return NULL;
+        Node *binary = new_node(p, NODE_BINARY);
+        if (!binary) return NULL;
+        binary->op = token->operator;
+        binary->left = left;
+        binary->right = right;
+        left = binary;
+    }
+
+    return left;
+}
+
+// parses an expression that must run up to the end of the statement
+static Node *parse_full_expression(Parser *p, const char *message) {
+    Node *node = parse_expression(p, 1);
+    if (node && p->pos < p->count) {
+        fail(p, message);
+        return NULL;
+    }
+    return node;
+}
+
+static Node *parse_variable_target(Parser *p, const char *message) {
+    const Token *token = peek(p);
+    if (!token || token->type != TOKEN_VARIABLE || is_function_name(token->text)) {
+        fail(p, message);
+        return NULL;
+    }
+    return parse_primary(p);
+}
+
+static int parse_print(Parser *p, Statement *stmt) {
+    // one item per top-level separator, plus the trailing expression
+    int capacity = 1;
+    int paren_level = 0;
+    for (int i = p->pos; i < p->count; i++) {
+        const Token *token = &p->tokens[i];
+        if (token->type != TOKEN_DELIMITER || !token->text) continue;
+        if (token->text[0] == '(') {
+            paren_level++;
+        } else if (token->text[0] == ')') {
+            paren_level--;
+        } else if (paren_level == 0 && (token->text[0] == ',' || token->text[0] == ';')) {
+            capacity++;
+        }
+    }
+
+    stmt->items = parser_alloc(p, sizeof(PrintItem) * capacity);
+    if (!stmt->items) return 0;
+
+    while (p->pos < p->count) {
+        PrintItem item = {NULL, 0};
+
+        if (!at_delimiter(p, ',') && !at_delimiter(p, ';')) {
+            item.expr = parse_expression(p, 1);
+            if (!item.expr) return 0;
+        }
+
+        if (at_delimiter(p, ',') || at_delimiter(p, ';')) {
+            item.separator = peek(p)->text[0];
+            p->pos++;
+        } else if (p->pos < p->count) {
+            return fail(p, "Invalid PRINT statement");
+        }
+
+        if (stmt->item_count >= capacity) {
+            return fail(p, "Invalid PRINT statement");
+        }
+        stmt->items[stmt->item_count++] = item;
+
+        if (!item.separator) break;
+    }
+
+    return 1;
+}
+
+// LET A$ = A$ + x + y: the left spine of the + chain starts at the target,
+// so x and y can be appended to it in place
+static int find_append_operands(Parser *p, Statement *stmt) {
+    const char *name = stmt->target->name;
+    if (stmt->target->type != NODE_VARIABLE || name[strlen(name) - 1] != '$') return 1;
+
+    int count = 0;
+    const Node *node = stmt->expr;
+    while (node->type == NODE_BINARY && node->op == OP_PLUS) {
+        count++;
+        node = node->left;
+    }
+    if (count == 0 || count > MAX_APPEND_OPERANDS ||
+        node->type != NODE_VARIABLE || node->slot != stmt->target->slot) {
+        return 1;
+    }
+
+    stmt->operands = parser_alloc(p, sizeof(Node *) * count);
+    if (!stmt->operands) return 0;
+    node = stmt->expr;
+    for (int i = count - 1; i >= 0; i--) {
+        stmt->operands[i] = node->right;
+        node = node->left;
+    }
+    stmt->operand_count = count;
+    return 1;
+}
+
+static int parse_let(Parser *p, Statement *stmt) {
+    stmt->target = parse_variable_target(p, "Invalid LET statement");
+    if (!stmt->target) return 0;
+
+    if (!at_operator(p, OP_EQUAL) || p->pos + 1 >= p->count) {
+        return fail(p, "Invalid LET statement");
+    }
+    p->pos++;
+
+    stmt->expr = parse_full_expression(p, "Invalid expression");
+    return stmt->expr != NULL && find_append_operands(p, stmt);
+}
+
+static int parse_input(Parser *p, Statement *stmt) {
+    const Token *token = peek(p);
+    if (token && token->type == TOKEN_STRING) {
+        stmt->prompt = token->text;
+        p->pos++;
+        if (at_delimiter(p, ';') || at_delimiter(p, ',')) p->pos++;
+    }
+
+    int capacity = 1;
+    for (int i = p->pos; i < p->count; i++) {
+        if (p->tokens[i].type == TOKEN_VARIABLE) capacity++;
+    }
+    stmt->operands = parser_alloc(p, sizeof(Node *) * capacity);
+    if (!stmt->operands) return 0;
+
+    while (1) {
+        Node *target = parse_variable_target(p, "INPUT requires a variable");
+        if (!target) return 0;
+        stmt->operands[stmt->operand_count++] = target;
+
+        if (!at_delimiter(p, ',')) break;
+        p->pos++;
+    }
+
+    if (p->pos < p->count) {
+        return fail(p, "Invalid INPUT statement");
+    }
+    return 1;
+}
+
+static int parse_statement_at(Parser *p, Statement *stmt);
+
+static int parse_if(Parser *p, Statement *stmt) {
+    stmt->expr = parse_expression(p, 1);
+    if (!stmt->expr) return 0;
+
+    if (!at_command(p, CMD_THEN)) {
+        return fail(p, "IF without THEN");
+    }
+    p->pos++;
+
+    const Token *token = peek(p);
+    if (!token) return 1;
+
+    if (token->type == TOKEN_NUMBER) {
+        // THEN <line> is a jump
+        stmt->target_line = (int)token->value.data.number;
+        p->pos++;
+        return 1;
+    }
+
+    stmt->then_statement = parser_alloc(p, sizeof(Statement));
+    if (!stmt->then_statement) return 0;
+    return parse_statement_at(p, stmt->then_statement);
+}
+
+static int parse_for(Parser *p, Statement *stmt) {
+    stmt->target = parse_variable_target(p, "Invalid FOR statement");
+    if (!stmt->target) return 0;
+    if (stmt->target->type != NODE_VARIABLE) {
+        return fail(p, "FOR requires a simple variable");
+    }
+
+    if (!at_operator(p, OP_EQUAL)) {
+        return fail(p, "Invalid FOR statement");
+    }
+    p->pos++;
+
+    stmt->expr = parse_expression(p, 1);
+    if (!stmt->expr) return 0;
+
+    if (!at_command(p, CMD_TO)) {
+        return fail(p, "FOR without TO");
+    }
+    p->pos++;
+
+    stmt->end_expr = parse_expression(p, 1);
+    if (!stmt->end_expr) return 0;
+
+    if (at_command(p, CMD_STEP)) {
+        p->pos++;
+        stmt->step_expr = parse_full_expression(p, "Invalid FOR statement");
+        if (!stmt->step_expr) return 0;
+    } else if (p->pos < p->count) {
+        return fail(p, "Invalid FOR statement");
+    }
+
+    return 1;
+}
+
+// DIM A(10), B$(5, 5): the declarations are kept as array nodes
+static int parse_dim(Parser *p, Statement *stmt) {
+    int capacity = 1;
+    for (int i = p->pos; i < p->count; i++) {
+        if (p->tokens[i].type == TOKEN_VARIABLE) capacity++;
+    }
+    stmt->operands = parser_alloc(p, sizeof(Node *) * capacity);
+    if (!stmt->operands) return 0;
+
+    while (1) {
+        Node *array = parse_variable_target(p, "DIM requires an array");
+        if (!array) return 0;
+        if (array->type != NODE_ARRAY || array->arg_count == 0) {
+            return fail(p, "DIM requires an array");
+        }
+        stmt->operands[stmt->operand_count++] = array;
+
+        if (!at_delimiter(p, ',')) break;
+        p->pos++;
+    }
+
+    if (p->pos < p->count) {
+        return fail(p, "Invalid DIM statement");
+    }
+    return 1;
+}
+
+// READ A, B$(I): the targets are kept like DIM declarations
+static int parse_read(Parser *p, Statement *stmt) {
+    int capacity = 1;
+    for (int i = p->pos; i < p->count; i++) {
+        if (p->tokens[i].type == TOKEN_VARIABLE) capacity++;
+    }
+    stmt->operands = parser_alloc(p, sizeof(Node *) * capacity);
+    if (!stmt->operands) return 0;
+
+    while (1) {
+        Node *target = parse_variable_target(p, "READ requires a variable");
+        if (!target) return 0;
+        stmt->operands[stmt->operand_count++] = target;
+
+        if (!at_delimiter(p, ',')) break;
+        p->pos++;
+    }
+
+    if (p->pos < p->count) {
+        return fail(p, "Invalid READ statement");
+    }
+    return 1;
+}
+
+// DEF FNA(X, Y) = expr: the parameters are only visible in the body
+static int parse_def(Parser *p, Statement *stmt) {
+    const Token *token = peek(p);
+    if (!token || token->type != TOKEN_VARIABLE || !is_function_name(token->text)) {
+        return fail(p, "DEF requires an FN name");
+    }
+    p->pos++;
+
+    Node *function = new_node(p, NODE_FN_CALL);
+    if (!function) return 0;
+    function->name = token->text;
+    function->slot = resolve_function(p->interp, token->text);
+    if (function->slot == -1) {
+        return fail(p, "Out of memory");
+    }
+    stmt->target = function;
+
+    Node *params[MAX_FUNCTION_ARGS];
+    if (at_delimiter(p, '(')) {
+        p->pos++;
+        while (!at_delimiter(p, ')')) {
+            const Token *name = peek(p);
+            if (!name || name->type != TOKEN_VARIABLE || is_function_name(name->text)) {
+                return fail(p, "Invalid DEF parameter");
+            }
+            if (function->arg_count >= MAX_FUNCTION_ARGS) {
+                return fail(p, "Too many function arguments");
+            }
+            for (int i = 0; i < function->arg_count; i++) {
+                if (strcasecmp(params[i]->name, name->text) == 0) {
+                    return fail(p, "Duplicate DEF parameter");
+                }
+            }
+            p->pos++;
+
+            Node *param = new_node(p, NODE_PARAM);
+            if (!param) return 0;
+            param->name = name->text;
+            param->slot = function->arg_count;
+            params[function->arg_count++] = param;
+
+            if (at_delimiter(p, ',')) {
+                p->pos++;
+            } else if (!at_delimiter(p, ')')) {
+                return fail(p, "Missing closing parenthesis in DEF");
+            }
+        }
+        p->pos++;
+
+        function->args = parser_alloc(p, sizeof(Node *) * (function->arg_count + 1));
+        if (!function->args) return 0;
+        memcpy(function->args, params, sizeof(Node *) * function->arg_count);
+    }
+
+    if (!at_operator(p, OP_EQUAL)) {
+        return fail(p, "Invalid DEF statement");
+    }
+    p->pos++;
+
+    p->params = function->args;
+    p->param_count = function->arg_count;
+    stmt->expr = parse_full_expression(p, "Invalid expression");
+    p->params = NULL;
+    p->param_count = 0;
+    return stmt->expr != NULL;
+}
+
+// a whole array in a MAT statement, named without subscripts
+static Node *parse_matrix(Parser *p) {
+    const Token *token = peek(p);
+    if (!token || token->type != TOKEN_VARIABLE) {
+        fail(p, "Invalid MAT statement");
+        return NULL;
+    }
+    const char suffix = token->text[strlen(token->text) - 1];
+    if (suffix == '$' || suffix == '%') {
+        fail(p, "MAT requires numeric arrays");
+        return NULL;
+    }
+
+    Node *node = parse_primary(p);
+    if (node && node->type != NODE_VARIABLE) {
+        fail(p, "Invalid MAT statement");
+        return NULL;
+    }
+    return node;
+}
+
+static int at_word(Parser *p, const char *word) {
+    const Token *token = peek(p);
+    return token && token->type == TOKEN_VARIABLE && strcasecmp(token->text, word) == 0;
+}
+
+static int expect_close(Parser *p) {
+    if (!at_delimiter(p, ')')) return fail(p, "Missing closing parenthesis in MAT");
+    p->pos++;
+    return 1;
+}
+
+// MAT C = A + B and the other whole-array forms; ZER, CON, IDN and TRN are only
+// recognized here, so they stay usable as variable names elsewhere
+static int parse_mat(Parser *p, Statement *stmt) {
+    stmt->target = parse_matrix(p);
+    if (!stmt->target) return 0;
+    if (!at_operator(p, OP_EQUAL)) {
+        return fail(p, "Invalid MAT statement");
+    }
+    p->pos++;
+
+    stmt->operands = parser_alloc(p, sizeof(Node *) * 2);
+    if (!stmt->operands) return 0;
+
+    if (at_word(p, "ZER") || at_word(p, "CON") || at_word(p, "IDN")) {
+        stmt->mat_op = at_word(p, "ZER") ? MAT_ZER : at_word(p, "CON") ? MAT_CON : MAT_IDN;
+        p->pos++;
+        if (at_delimiter(p, '(')) {
+            // new bounds, as in DIM, ride on the target as its subscripts
+            p->pos++;
+            stmt->target->type = NODE_ARRAY;
+            if (!parse_arguments(p, stmt->target, MAX_ARRAY_DIMENSIONS, "Too many subscripts",
+                                 "Missing closing parenthesis in MAT")) {
+                return 0;
+            }
+        }
+    } else if (at_word(p, "TRN")) {
+        stmt->mat_op = MAT_TRN;
+        p->pos++;
+        if (!at_delimiter(p, '(')) {
+            return fail(p, "Invalid MAT statement");
+        }
+        p->pos++;
+        stmt->operands[stmt->operand_count] = parse_matrix(p);
+        if (!stmt->operands[stmt->operand_count++] || !expect_close(p)) return 0;
+    } else if (at_delimiter(p, '(')) {
+        stmt->mat_op = MAT_SCALE;
+        p->pos++;
+        stmt->expr = parse_expression(p, 1);
+        if (!stmt->expr || !expect_close(p)) return 0;
+        if (!at_operator(p, OP_MULTIPLY)) {
+            return fail(p, "Invalid MAT statement");
+        }
+        p->pos++;
+        stmt->operands[stmt->operand_count] = parse_matrix(p);
+        if (!stmt->operands[stmt->operand_count++]) return 0;
+    } else {
+        stmt->mat_op = MAT_COPY;
+        stmt->operands[stmt->operand_count] = parse_matrix(p);
+        if (!stmt->operands[stmt->operand_count++]) return 0;
+
+        if (at_operator(p, OP_PLUS) || at_operator(p, OP_MINUS) || at_operator(p, OP_MULTIPLY)) {
+            const Operator op = peek(p)->operator;
+            stmt->mat_op = op == OP_PLUS ? MAT_ADD : op == OP_MINUS ? MAT_SUBTRACT : MAT_MULTIPLY;
+            p->pos++;
+            stmt->operands[stmt->operand_count] = parse_matrix(p);
+            if (!stmt->operands[stmt->operand_count++]) return 0;
+        }
+    }
+
+    if (p->pos < p->count) {
+        return fail(p, "Invalid MAT statement");
+    }
+    return 1;
+}
+
+static int parse_jump(Parser *p, Statement *stmt, const char *message) {
+    const Token *token = peek(p);
+    if (!token || token->type != TOKEN_NUMBER) {
+        return fail(p, message);
+    }
+    stmt->target_line = (int)token->value.data.number;
+    p->pos++;
+    return 1;
+}
+
+// ON n GOTO l1, l2, ...: the line numbers become a table indexed by n
+static int parse_on(Parser *p, Statement *stmt) {
+    stmt->expr = parse_expression(p, 1);
+    if (!stmt->expr) return 0;
+
+    if (!at_command(p, CMD_GOTO) && !at_command(p, CMD_GOSUB)) {
+        return fail(p, "ON requires GOTO or GOSUB");
+    }
+    stmt->on_command = peek(p)->command;
+    p->pos++;
+
+    // the targets are separated by commas
+    const int capacity = (p->count - p->pos) / 2 + 1;
+    stmt->target_lines = parser_alloc(p, sizeof(int) * capacity);
+    stmt->target_indices = parser_alloc(p, sizeof(int) * capacity);
+    if (!stmt->target_lines || !stmt->target_indices) return 0;
+
+    while (1) {
+        const Token *token = peek(p);
+        if (!token || token->type != TOKEN_NUMBER) {
+            return fail(p, "ON requires line numbers");
+        }
+        stmt->target_lines[stmt->target_count] = (int)token->value.data.number;
+        stmt->target_indices[stmt->target_count++] = -1;
+        p->pos++;
+
+        if (!at_delimiter(p, ',')) break;
+        p->pos++;
+    }
+
+    if (p->pos < p->count) {
+        return fail(p, "Invalid ON statement");
+    }
+    return 1;
+}
+
+static int parse_statement_at(Parser *p, Statement *stmt) {
+    stmt->command = CMD_UNKNOWN;
+    stmt->target_line = -1;
+    stmt->target_index = -1;
+
+    Token *token = peek(p);
+    if (!token) {
+        stmt->command = CMD_REM;
+        return 1;
+    }
+
+    if (token->type == TOKEN_VARIABLE) {
+        // implicit LET
+        stmt->command = CMD_LET;
+        return parse_let(p, stmt);
+    }
+
+    if (token->type != TOKEN_COMMAND) {
+        return fail(p, "Invalid statement");
+    }
+
+    stmt->command = token->command;
+    p->pos++;
+
+    switch (stmt->command) {
+        case CMD_PRINT:
+            return parse_print(p, stmt);
+        case CMD_LET:
+            return parse_let(p, stmt);
+        case CMD_INPUT:
+            return parse_input(p, stmt);
+        case CMD_IF:
+            return parse_if(p, stmt);
+        case CMD_FOR:
+            return parse_for(p, stmt);
+        case CMD_NEXT:
+            if (peek(p) && peek(p)->type == TOKEN_VARIABLE) {
+                stmt->target = parse_primary(p);
+                return stmt->target != NULL;
+            }
+            return 1;
+        case CMD_DIM:
+            return parse_dim(p, stmt);
+        case CMD_MAT:
+            return parse_mat(p, stmt);
+        case CMD_READ:
+            return parse_read(p, stmt);
+        case CMD_DEF:
+            return parse_def(p, stmt);
+        case CMD_RESTORE:
+            return !peek(p) || parse_jump(p, stmt, "RESTORE requires line number");
+        case CMD_GOTO:
+            return parse_jump(p, stmt, "GOTO requires line number");
+        case CMD_GOSUB:
+            return parse_jump(p, stmt, "GOSUB requires line number");
+        case CMD_ON:
+            return parse_on(p, stmt);
+        case CMD_REM:
+        case CMD_DATA:
+            // DATA items are collected from the line text, see program/data_pool.c
+            p->pos = p->count;
+            return 1;
+        default:
+            // other commands are reported when executed
+            return 1;
+    }
+}
+
+Statement *parse_statement(Interpreter *interp, Arena *arena, Token *tokens, int token_count) {
+    Parser parser = {interp, arena, tokens, tokens ? token_count : 0, 0, NULL, NULL, 0};
+
+    Statement *stmt = parser_alloc(&parser, sizeof(Statement));
+    if (!stmt) return NULL;
+
+    if (!parse_statement_at(&parser, stmt)) {
+        // syntax errors are reported when the statement runs, like the token walker did
+        stmt->error = parser.error ? parser.error : "Syntax error";
+    } else {
+        optimize_statement(interp, arena, stmt);
+    }
+
+    return stmt;
+}
@@ -0,0 +1,116 @@
+#include "interpreter/basic_interpreter.h"
+
+// the items of every DATA line are collected into one pool of typed values
+// when the program is resolved: numbers are parsed and strings become
+// immortal arena strings, so READ only takes the next value and RESTORE n
+// seeks to the first item of line n. the pool is built from the line text,
+// which program images keep as well.
+
+// the text after the DATA keyword, or NULL when the line is not a DATA statement
+static const char *data_items(const char *text) {
+    if (!text) return NULL;
+    while (isspace((unsigned char)*text)) text++;
+    if (strncasecmp(text, "DATA", 4) != 0) return NULL;
+
+    const char next = text[4];
+    if (isalnum((unsigned char)next) || next == '$' || next == '_' || next == '%') return NULL;
+    return text + 4;
+}
+
+static int add_data_value(Interpreter *interp, Value value) {
+    if (interp->data_count >= interp->data_capacity) {
+        Value *values = grow_array(interp->data_values, &interp->data_capacity, sizeof(Value));
+        if (!values) return 0;
+        interp->data_values = values;
+    }
+    interp->data_values[interp->data_count++] = value;
+    return 1;
+}
+
+// an unquoted item is a number when all of it parses as one, otherwise its trimmed text
+static int add_unquoted_item(Interpreter *interp, const char *start, const char *end) {
+    while (start < end && isspace((unsigned char)*start)) start++;
+    while (end > start && isspace((unsigned char)end[-1])) end--;
+
+    const size_t length = (size_t)(end - start);
+
+    double number;
+    if (parse_number(start, length, &number)) {
+        return add_data_value(interp, create_number_value(number));
+    }
+
+    String *string = arena_alloc(&interp->arena, sizeof(String) + length + 1);
+    if (!string) return 0;
+    string->refcount = STRING_IMMORTAL;
+    string->length = length;
+    string->capacity = length;
+    memcpy(string->data, start, length);
+    string->data[length] = '\0';
+
+    Value value;
+    value.type = VALUE_STRING;
+    value.data.string = string;
+    return add_data_value(interp, value);
+}
+
+// items are separated by commas; quoted items keep their commas and use the literal escapes
+static int add_data_line(Interpreter *interp, const char *items) {
+    const char *ptr = items;
+    while (isspace((unsigned char)*ptr)) ptr++;
+    if (!*ptr) return 1; // a bare DATA has no items
+
+    while (1) {
+        while (isspace((unsigned char)*ptr)) ptr++;
+
+        if (*ptr == '"') {
+            String *string = scan_string_literal(&interp->arena, &ptr);
+            if (!string) return *ptr == '\0'; // an unterminated literal ends the line
+            Value value;
+            value.type = VALUE_STRING;
+            value.data.string = string;
+            if (!add_data_value(interp, value)) return 0;
+
+            // anything between the closing quote and the next comma is ignored
+            while (*ptr && *ptr != ',') ptr++;
+        } else {
+            const char *end = ptr;
+            while (*end && *end != ',') end++;
+            if (!add_unquoted_item(interp, ptr, end)) return 0;
+            ptr = end;
+        }
+
+        if (*ptr != ',') return 1;
+        ptr++;
+    }
+}
+
+void build_data_pool(Interpreter *interp) {
+    interp->data_count = 0;
+    interp->data_pointer = 0;
+    int failed = 0;
+    for (int i = 0; i < interp->line_count; i++) {
+        Line *line = &interp->lines[i];
+        line->data_index = interp->data_count;
+
+        const char *items = data_items(line->text);
+        if (items && !failed && !add_data_line(interp, items)) {
+            print_error(interp, "Out of memory");
+            failed = 1;
+        }
+    }
+}
+
+// the next DATA item; pool strings are immortal, so the value needs no retain
+int read_data(Interpreter *interp, Value *value) {
+    if (interp->data_pointer >= interp->data_count) {
+        print_error(interp, "Out of DATA");
+        return 0;
+    }
+    *value = interp->data_values[interp->data_pointer++];
+    return 1;
+}
+
+// RESTORE goes back to the first item, RESTORE n to the first item at or after line n
+void restore_data(Interpreter *interp, int line_index) {
+    interp->data_pointer = line_index >= 0 ? interp->lines[line_index].data_index : 0;
+}
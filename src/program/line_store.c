@@ -0,0 +1,181 @@
+#include "interpreter/basic_interpreter.h"
+
+// lines are kept in line number order in a gap buffer:
+// lines[0, gap_start) followed by lines[gap_end, line_capacity).
+// edits move the gap to the edit point, so runs of nearby edits (typing or
+// pasting a program) cost O(log n) to locate plus O(1) to apply.
+// compact_lines() closes the gap before the program runs, so execution can
+// index lines[] directly.
+
+static int gap_size(const Interpreter *interp) {
+    return interp->gap_end - interp->gap_start;
+}
+
+Line *get_line(Interpreter *interp, int index) {
+    if (!interp || index < 0 || index >= interp->line_count) return NULL;
+
+    return &interp->lines[index < interp->gap_start ? index : index + gap_size(interp)];
+}
+
+// first logical index whose line number is not below line_number
+static int lower_bound(Interpreter *interp, int line_number) {
+    int low = 0;
+    int high = interp->line_count;
+    while (low < high) {
+        const int mid = low + (high - low) / 2;
+        if (get_line(interp, mid)->line_number < line_number) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static void move_gap(Interpreter *interp, int position) {
+    if (position < interp->gap_start) {
+        const int count = interp->gap_start - position;
+        memmove(&interp->lines[interp->gap_end - count], &interp->lines[position], sizeof(Line) * count);
+        interp->gap_start -= count;
+        interp->gap_end -= count;
+    } else if (position > interp->gap_start) {
+        const int count = position - interp->gap_start;
+        memmove(&interp->lines[interp->gap_start], &interp->lines[interp->gap_end], sizeof(Line) * count);
+        interp->gap_start += count;
+        interp->gap_end += count;
+    }
+}
+
+void compact_lines(Interpreter *interp) {
+    if (!interp) return;
+
+    move_gap(interp, interp->line_count);
+}
+
+// the gap is moved to the end first, so growing never has to split it
+static int reserve_line(Interpreter *interp) {
+    if (gap_size(interp) > 0) return 1;
+
+    compact_lines(interp);
+    Line *lines = grow_array(interp->lines, &interp->line_capacity, sizeof(Line));
+    if (!lines) {
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+    interp->lines = lines;
+    interp->gap_end = interp->line_capacity;
+    return 1;
+}
+
+int store_line(Interpreter *interp, const Line *line) {
+    if (!interp || !line) return 0;
+
+    const int position = lower_bound(interp, line->line_number);
+    Line *existing = get_line(interp, position);
+    if (existing && existing->line_number == line->line_number) {
+        // re-entering a line number replaces the line, its old text stays in the arena
+        *existing = *line;
+        invalidate_program(interp);
+        return 1;
+    }
+
+    if (!reserve_line(interp)) return 0;
+    move_gap(interp, position);
+    interp->lines[interp->gap_start++] = *line;
+    interp->line_count++;
+    invalidate_program(interp);
+    return 1;
+}
+
+int delete_line(Interpreter *interp, int line_number) {
+    if (!interp) return 0;
+
+    const int position = lower_bound(interp, line_number);
+    const Line *existing = get_line(interp, position);
+    if (!existing || existing->line_number != line_number) return 0;
+
+    move_gap(interp, position + 1);
+    interp->gap_start--;
+    interp->line_count--;
+    invalidate_program(interp);
+    return 1;
+}
+
+// bulk loading appends in file order, sort_lines() restores the ordering afterwards
+int append_line(Interpreter *interp, const Line *line) {
+    if (!interp || !line) return 0;
+
+    compact_lines(interp);
+    if (!reserve_line(interp)) return 0;
+    interp->lines[interp->gap_start++] = *line;
+    interp->line_count++;
+    invalidate_program(interp);
+    return 1;
+}
+
+static void merge_sort_lines(Line *lines, Line *scratch, int count) {
+    if (count < 2) return;
+
+    const int half = count / 2;
+    merge_sort_lines(lines, scratch, half);
+    merge_sort_lines(lines + half, scratch, count - half);
+
+    // stable: on equal numbers the earlier line is taken first
+    int left = 0;
+    int right = half;
+    int out = 0;
+    while (left < half && right < count) {
+        if (lines[right].line_number < lines[left].line_number) {
+            scratch[out++] = lines[right++];
+        } else {
+            scratch[out++] = lines[left++];
+        }
+    }
+    while (left < half) scratch[out++] = lines[left++];
+    while (right < count) scratch[out++] = lines[right++];
+    memcpy(lines, scratch, sizeof(Line) * count);
+}
+
+// O(n log n); when a line number repeats, the line that came last wins
+int sort_lines(Interpreter *interp) {
+    if (!interp) return 0;
+
+    compact_lines(interp);
+    Line *lines = interp->lines;
+    const int count = interp->line_count;
+
+    int sorted = 1;
+    for (int i = 1; i < count && sorted; i++) {
+        sorted = lines[i - 1].line_number < lines[i].line_number;
+    }
+    if (sorted) return 1;
+
+    Line *scratch = malloc(sizeof(Line) * count);
+    if (!scratch) {
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+    merge_sort_lines(lines, scratch, count);
+    free(scratch);
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (kept > 0 && lines[kept - 1].line_number == lines[i].line_number) {
+            lines[kept - 1] = lines[i];
+        } else {
+            lines[kept++] = lines[i];
+        }
+    }
+    interp->line_count = kept;
+    interp->gap_start = kept;
+    invalidate_program(interp);
+    return 1;
+}
+
+int find_line_by_number(Interpreter *interp, int line_number) {
+    if (!interp) return -1;
+
+    const int position = lower_bound(interp, line_number);
+    const Line *line = get_line(interp, position);
+    return line && line->line_number == line_number ? position : -1;
+}
@@ -0,0 +1,271 @@
+#include "interpreter/basic_interpreter.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define LOAD_LINES_PER_THREAD 4096
+#define MAX_LOAD_THREADS 8
+
+typedef struct line_span_t {
+    const char *start;
+    size_t length;
+} LineSpan;
+
+// splits off the line number and tokenizes the rest of the line into the arena;
+// touches nothing but the arena, so loader threads can run it concurrently
+int tokenize_line(Arena *arena, const char *text, size_t length, int default_number, Line *line) {
+    const char *ptr = text;
+    const char *end = text + length;
+    while (ptr < end && isspace((unsigned char)*ptr)) ptr++;
+
+    // get the line number
+    if (ptr < end && isdigit((unsigned char)*ptr)) {
+        int number = 0;
+        while (ptr < end && isdigit((unsigned char)*ptr)) {
+            number = number * 10 + (*ptr - '0');
+            ptr++;
+        }
+        line->line_number = number;
+        while (ptr < end && isspace((unsigned char)*ptr)) ptr++;
+    } else {
+        line->line_number = default_number;
+    }
+
+    // copy text into the arena, without the line terminator
+    while (end > ptr && (end[-1] == '\n' || end[-1] == '\r')) end--;
+    line->text = arena_strndup(arena, ptr, (size_t)(end - ptr));
+    if (!line->text) return 0;
+
+    line->tokens = tokenize(arena, line->text, &line->token_count);
+    line->statement = NULL;
+    line->data_index = 0;
+    return line->tokens || line->token_count == 0;
+}
+
+// maps a file read-only; Windows builds read it into memory instead
+int map_file(const char *filename, MappedFile *file) {
+    file->data = NULL;
+    file->size = 0;
+    file->mapped = 0;
+
+#ifdef _WIN32
+    FILE *stream = fopen(filename, "rb");
+    if (!stream) return 0;
+    fseek(stream, 0, SEEK_END);
+    const long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    char *data = malloc(size > 0 ? (size_t)size : 1);
+    if (!data || (size > 0 && fread(data, 1, (size_t)size, stream) != (size_t)size)) {
+        free(data);
+        fclose(stream);
+        return 0;
+    }
+    fclose(stream);
+    file->data = data;
+    file->size = size > 0 ? (size_t)size : 0;
+#else
+    const int fd = open(filename, O_RDONLY);
+    if (fd == -1) return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        close(fd);
+        return 0;
+    }
+
+    file->size = (size_t)info.st_size;
+    if (file->size > 0) {
+        void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return 0;
+        }
+        file->data = data;
+        file->mapped = 1;
+    }
+    close(fd);
+#endif
+    return 1;
+}
+
+void unmap_file(MappedFile *file) {
+    if (!file->data) return;
+
+#ifdef _WIN32
+    free((void *)file->data);
+#else
+    if (file->mapped) {
+        munmap((void *)file->data, file->size);
+    }
+#endif
+    file->data = NULL;
+    file->size = 0;
+    file->mapped = 0;
+}
+
+// spans point into the mapping, blank lines are dropped; lines of any length are kept whole
+static LineSpan *split_lines(const MappedFile *source, int *span_count) {
+    int capacity = 0;
+    LineSpan *spans = NULL;
+    *span_count = 0;
+
+    const char *ptr = source->data;
+    const char *end = source->data + source->size;
+    while (ptr < end) {
+        const char *newline = memchr(ptr, '\n', (size_t)(end - ptr));
+        const char *line_end = newline ? newline : end;
+
+        const char *first = ptr;
+        while (first < line_end && isspace((unsigned char)*first)) first++;
+        if (first < line_end) {
+            if (*span_count >= capacity) {
+                LineSpan *grown = grow_array(spans, &capacity, sizeof(LineSpan));
+                if (!grown) {
+                    free(spans);
+                    return NULL;
+                }
+                spans = grown;
+            }
+            spans[*span_count].start = first;
+            spans[*span_count].length = (size_t)(line_end - first);
+            (*span_count)++;
+        }
+        ptr = newline ? newline + 1 : end;
+    }
+    return spans;
+}
+
+typedef struct load_worker_t {
+    const LineSpan *spans;
+    Line *lines;
+    int first;
+    int count;
+    Arena arena;
+    int failed;
+} LoadWorker;
+
+static void *run_load_worker(void *argument) {
+    LoadWorker *worker = argument;
+    for (int i = worker->first; i < worker->first + worker->count && !worker->failed; i++) {
+        // unnumbered lines continue the 10, 20, 30... numbering by position
+        if (!tokenize_line(&worker->arena, worker->spans[i].start, worker->spans[i].length,
+                           i * 10 + 10, &worker->lines[i])) {
+            worker->failed = 1;
+        }
+    }
+    return NULL;
+}
+
+static int worker_count(int line_count) {
+    int count = line_count / LOAD_LINES_PER_THREAD;
+#ifdef _WIN32
+    count = 1;
+#else
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && count > cpus) count = (int)cpus;
+#endif
+    if (count > MAX_LOAD_THREADS) count = MAX_LOAD_THREADS;
+    return count < 1 ? 1 : count;
+}
+
+// tokenizes every span into lines[], on worker threads for large programs;
+// the workers' arenas are handed to the program arena afterwards
+static int tokenize_spans(Interpreter *interp, const LineSpan *spans, Line *lines, int line_count) {
+    const int count = worker_count(line_count);
+    LoadWorker workers[MAX_LOAD_THREADS];
+
+    const int per_worker = (line_count + count - 1) / count;
+    for (int i = 0; i < count; i++) {
+        LoadWorker *worker = &workers[i];
+        worker->spans = spans;
+        worker->lines = lines;
+        worker->first = i * per_worker;
+        worker->count = worker->first + per_worker > line_count ? line_count - worker->first : per_worker;
+        if (worker->count < 0) worker->count = 0;
+        arena_init(&worker->arena);
+        worker->failed = 0;
+    }
+
+#ifdef _WIN32
+    run_load_worker(&workers[0]);
+#else
+    pthread_t threads[MAX_LOAD_THREADS];
+    int started[MAX_LOAD_THREADS] = {0};
+    for (int i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, run_load_worker, &workers[i]) == 0;
+    }
+    run_load_worker(&workers[0]);
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            run_load_worker(&workers[i]);
+        }
+    }
+#endif
+
+    int ok = 1;
+    for (int i = 0; i < count; i++) {
+        if (workers[i].failed) ok = 0;
+        arena_adopt(&interp->arena, &workers[i].arena);
+    }
+    return ok;
+}
+
+int load_program(Interpreter *interp, const char *filename) {
+    if (!interp || !filename) {
+        return 0;
+    }
+
+    MappedFile source;
+    if (!map_file(filename, &source)) {
+        printf("Error: Cannot open file %s\n", filename);
+        return 0;
+    }
+
+    int line_count;
+    LineSpan *spans = split_lines(&source, &line_count);
+    Line *lines = line_count > 0 ? malloc(sizeof(Line) * line_count) : NULL;
+    if (line_count > 0 && (!spans || !lines)) {
+        free(spans);
+        free(lines);
+        unmap_file(&source);
+        print_error(interp, "Out of memory");
+        return 0;
+    }
+
+    const int tokenized = line_count == 0 || tokenize_spans(interp, spans, lines, line_count);
+    free(spans);
+    unmap_file(&source);
+    if (!tokenized) {
+        free(lines);
+        print_error(interp, "Tokenization failed");
+        return 0;
+    }
+
+    // parsing resolves variable slots in the interpreter, so it stays serial and in file order
+    for (int i = 0; i < line_count; i++) {
+        lines[i].statement = parse_statement(interp, &interp->arena, lines[i].tokens, lines[i].token_count);
+        if (!lines[i].statement || !append_line(interp, &lines[i])) {
+            free(lines);
+            if (strlen(interp->error_message) == 0) {
+                print_error(interp, "Memory allocation failed");
+            }
+            return 0;
+        }
+    }
+    free(lines);
+
+    // lines were appended in file order, one O(n log n) merge orders them
+    if (!sort_lines(interp)) {
+        return 0;
+    }
+
+    resolve_program(interp);
+    return 1;
+}
@@ -0,0 +1,91 @@
+// generated by scripts/gen_keywords.py, edit the keyword list there and rerun
+#include "interpreter/basic_interpreter.h"
+
+#define MIN_KEYWORD_LENGTH 2
+#define MAX_KEYWORD_LENGTH 7
+#define KEYWORD_SLOTS 63
+
+// letters map to the same value in either case, other characters fall outside the table
+static const unsigned char asso_values[256] = {
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63,  2, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63,  4, 39, 31, 35,  2,  7,  0, 63,  6, 63, 63, 29, 15,  4,  0,
+    11, 27, 15, 16,  0,  4,  5,  0, 43, 63, 63, 63, 63, 63, 63, 63,
+    63,  4, 39, 31, 35,  2,  7,  0, 63,  6, 63, 63, 29, 15,  4,  0,
+    11, 27, 15, 16,  0,  4,  5,  0, 43, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63,
+};
+
+static const Keyword keyword_slots[KEYWORD_SLOTS] = {
+    [2] = {"TO", TOKEN_COMMAND, CMD_TO},
+    [4] = {"GOTO", TOKEN_COMMAND, CMD_GOTO},
+    [6] = {"ON", TOKEN_COMMAND, CMD_ON},
+    [7] = {"NOT", TOKEN_OPERATOR, OP_NOT},
+    [9] = {"NEW", TOKEN_COMMAND, CMD_NEW},
+    [10] = {"THEN", TOKEN_COMMAND, CMD_THEN},
+    [11] = {"TAN", TOKEN_FUNCTION, FUNC_TAN},
+    [13] = {"INT", TOKEN_FUNCTION, FUNC_INT},
+    [15] = {"INPUT", TOKEN_COMMAND, CMD_INPUT},
+    [17] = {"OR", TOKEN_OPERATOR, OP_OR},
+    [20] = {"PRINT", TOKEN_COMMAND, CMD_PRINT},
+    [21] = {"IF", TOKEN_COMMAND, CMD_IF},
+    [22] = {"MAT", TOKEN_COMMAND, CMD_MAT},
+    [23] = {"RIGHT$", TOKEN_FUNCTION, FUNC_RIGHT},
+    [24] = {"ELSE", TOKEN_COMMAND, CMD_ELSE},
+    [25] = {"FOR", TOKEN_COMMAND, CMD_FOR},
+    [26] = {"RUN", TOKEN_COMMAND, CMD_RUN},
+    [29] = {"SIN", TOKEN_FUNCTION, FUNC_SIN},
+    [31] = {"STOP", TOKEN_COMMAND, CMD_STOP},
+    [33] = {"STEP", TOKEN_COMMAND, CMD_STEP},
+    [34] = {"LET", TOKEN_COMMAND, CMD_LET},
+    [35] = {"REM", TOKEN_COMMAND, CMD_REM},
+    [36] = {"LEFT$", TOKEN_FUNCTION, FUNC_LEFT},
+    [37] = {"STR$", TOKEN_FUNCTION, FUNC_STR},
+    [38] = {"LEN", TOKEN_FUNCTION, FUNC_LEN},
+    [39] = {"RESTORE", TOKEN_COMMAND, CMD_RESTORE},
+    [40] = {"RETURN", TOKEN_COMMAND, CMD_RETURN},
+    [41] = {"VAL", TOKEN_FUNCTION, FUNC_VAL},
+    [43] = {"DATA", TOKEN_COMMAND, CMD_DATA},
+    [44] = {"END", TOKEN_COMMAND, CMD_END},
+    [46] = {"AND", TOKEN_OPERATOR, OP_AND},
+    [47] = {"DEF", TOKEN_COMMAND, CMD_DEF},
+    [48] = {"GOSUB", TOKEN_COMMAND, CMD_GOSUB},
+    [49] = {"LIST", TOKEN_COMMAND, CMD_LIST},
+    [50] = {"COS", TOKEN_FUNCTION, FUNC_COS},
+    [51] = {"NEXT", TOKEN_COMMAND, CMD_NEXT},
+    [52] = {"CHR$", TOKEN_FUNCTION, FUNC_CHR},
+    [53] = {"MOD", TOKEN_OPERATOR, OP_MOD},
+    [54] = {"ASC", TOKEN_FUNCTION, FUNC_ASC},
+    [55] = {"CLEAR", TOKEN_COMMAND, CMD_CLEAR},
+    [56] = {"MID$", TOKEN_FUNCTION, FUNC_MID},
+    [57] = {"RND", TOKEN_FUNCTION, FUNC_RND},
+    [58] = {"READ", TOKEN_COMMAND, CMD_READ},
+    [59] = {"DIM", TOKEN_COMMAND, CMD_DIM},
+    [61] = {"SQR", TOKEN_FUNCTION, FUNC_SQR},
+    [62] = {"ABS", TOKEN_FUNCTION, FUNC_ABS},
+};
+
+// one hash and at most one compare per identifier
+const Keyword *find_keyword(const char *text, size_t length) {
+    if (!text || length < MIN_KEYWORD_LENGTH || length > MAX_KEYWORD_LENGTH) return NULL;
+
+    const unsigned char *word = (const unsigned char *)text;
+    const unsigned int hash = (unsigned int)length + asso_values[word[0]] +
+                              asso_values[word[length - 2]] + asso_values[word[length - 1]];
+    if (hash >= KEYWORD_SLOTS) return NULL;
+
+    const Keyword *keyword = &keyword_slots[hash];
+    if (!keyword->name || strncasecmp(text, keyword->name, length) != 0 || keyword->name[length] != '\0') {
+        return NULL;
+    }
+    return keyword;
+}
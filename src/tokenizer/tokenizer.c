@@ -2,18 +2,81 @@
 
 #define MAX_TOKENS 1000
 
-Token *tokenize(const char *text, int *token_count) {
-    if (!text || !token_count) {
-        if (token_count) *token_count = 0;
+// reads the literal after the opening quote at *ptr into an immortal String,
+// decoding escapes; *ptr ends after the closing quote, or on the terminating
+// NUL of an unterminated literal, which returns NULL like running out of memory
+String *scan_string_literal(Arena *arena, const char **ptr) {
+    const char *start = *ptr + 1; // skip opening quote
+
+    // find the closing quote first so the literal is allocated at its exact size
+    const char *end = start;
+    while (*end && *end != '"') {
+        end += (*end == '\\' && *(end + 1)) ? 2 : 1;
+    }
+    if (*end != '"') {
+        *ptr = end;
         return NULL;
     }
+    *ptr = end + 1; // skip closing quote
 
-    Token *tokens = malloc(sizeof(Token) * MAX_TOKENS);
-    if (!tokens) {
-        *token_count = 0;
+    // the literal is an immortal String, values share it without copying
+    String *string = arena_alloc(arena, sizeof(String) + (size_t)(end - start) + 1);
+    if (!string) return NULL;
+
+    char *literal = string->data;
+    size_t literal_len = 0;
+    const char *cursor = start;
+    while (cursor < end) {
+        if (*cursor == '\\' && *(cursor + 1)) {
+            switch (*(cursor + 1)) {
+                case 'n':
+                    literal[literal_len++] = '\n';
+                    cursor += 2;
+                    break;
+                case 't':
+                    literal[literal_len++] = '\t';
+                    cursor += 2;
+                    break;
+                case 'r':
+                    literal[literal_len++] = '\r';
+                    cursor += 2;
+                    break;
+                case '\\':
+                    literal[literal_len++] = '\\';
+                    cursor += 2;
+                    break;
+                case '"':
+                    literal[literal_len++] = '"';
+                    cursor += 2;
+                    break;
+                case '\'':
+                    literal[literal_len++] = '\'';
+                    cursor += 2;
+                    break;
+                default:
+                    literal[literal_len++] = *cursor++;
+                    break;
+            }
+        } else {
+            literal[literal_len++] = *cursor++;
+        }
+    }
+
+    literal[literal_len] = '\0';
+    string->refcount = STRING_IMMORTAL;
+    string->length = literal_len;
+    string->capacity = literal_len;
+    return string;
+}
+
+// tokens are scanned into a stack buffer and copied into the arena at their exact count
+Token *tokenize(Arena *arena, const char *text, int *token_count) {
+    if (!arena || !text || !token_count) {
+        if (token_count) *token_count = 0;
         return NULL;
     }
-    
+
+    Token tokens[MAX_TOKENS];
     *token_count = 0;
 
     const char *ptr = text;
@@ -36,89 +99,37 @@ Token *tokenize(const char *text, int *token_count) {
 
             int len = ptr - start;
             if (len > 0) {
-                token->text = malloc(len + 1);
+                token->text = arena_strndup(arena, start, len);
                 if (token->text) {
-                    strncpy(token->text, start, len);
-                    token->text[len] = '\0';
-
                     token->type = TOKEN_NUMBER;
                     token->value = create_number_value(atof(token->text));
                 }
             }
         } else if (*ptr == '"') { // string literals
-            ptr++; // skip opening quote
-            
-            char temp_buffer[MAX_LINE_LENGTH];
-            int temp_len = 0;
-            
-            while (*ptr && *ptr != '"' && temp_len < MAX_LINE_LENGTH - 1) {
-                if (*ptr == '\\' && *(ptr + 1)) {
-                    switch (*(ptr + 1)) {
-                        case 'n':
-                            temp_buffer[temp_len++] = '\n';
-                            ptr += 2;
-                            break;
-                        case 't':
-                            temp_buffer[temp_len++] = '\t';
-                            ptr += 2;
-                            break;
-                        case 'r':
-                            temp_buffer[temp_len++] = '\r';
-                            ptr += 2;
-                            break;
-                        case '\\':
-                            temp_buffer[temp_len++] = '\\';
-                            ptr += 2;
-                            break;
-                        case '"':
-                            temp_buffer[temp_len++] = '"';
-                            ptr += 2;
-                            break;
-                        case '\'':
-                            temp_buffer[temp_len++] = '\'';
-                            ptr += 2;
-                            break;
-                        default:
-                            temp_buffer[temp_len++] = *ptr++;
-                            break;
-                    }
-                } else {
-                    temp_buffer[temp_len++] = *ptr++;
-                }
-            }
-
-            if (*ptr != '"') {
-                token->type = TOKEN_ERROR;
-                (*token_count)--; 
+            String *string = scan_string_literal(arena, &ptr);
+            if (!string && !*ptr) {
+                // unterminated literal
+                (*token_count)--;
                 continue;
             }
-
-            temp_buffer[temp_len] = '\0';
-            
-            token->text = malloc(temp_len + 1);
-            if (token->text) {
-                strcpy(token->text, temp_buffer);
+            if (string) {
+                // the literal belongs to the arena, token values are never cleaned up
+                token->text = string->data;
                 token->type = TOKEN_STRING;
-                token->value = create_string_value(temp_buffer);
+                token->value.type = VALUE_STRING;
+                token->value.data.string = string;
             }
-            
-            ptr++; // skip closing quote
         } else if (strncmp(ptr, "<=", 2) == 0 || strncmp(ptr, ">=", 2) == 0 ||
                  strncmp(ptr, "<>", 2) == 0) {
-            token->text = malloc(3);
+            token->text = arena_strndup(arena, ptr, 2);
             if (token->text) {
-                strncpy(token->text, ptr, 2);
-                token->text[2] = '\0';
                 token->type = TOKEN_OPERATOR;
                 token->operator = get_operator(token->text);
             }
             ptr += 2;
-        } else if (strchr("+-*/^=<>(),:;", *ptr)) { // single character operators and delimiters
-            token->text = malloc(2);
+        } else if (strchr("+-*/\\^=<>(),:;", *ptr)) { // single character operators and delimiters
+            token->text = arena_strndup(arena, ptr, 1);
             if (token->text) {
-                token->text[0] = *ptr;
-                token->text[1] = '\0';
-
                 if (strchr("(),:;", *ptr)) {
                     token->type = TOKEN_DELIMITER;
                 } else {
@@ -130,36 +141,29 @@ Token *tokenize(const char *text, int *token_count) {
         } else if (isalpha(*ptr)) { // identifiers (commands, functions, variables, operators)
             const char *start = ptr;
             while (isalnum(*ptr) || *ptr == '$' || *ptr == '_') ptr++;
+            if (*ptr == '%') ptr++; // A% integer variables
 
             int len = ptr - start;
             if (len > 0 && len < 32) { // limit identifier length
-                token->text = malloc(len + 1);
+                token->text = arena_strndup(arena, start, len);
                 if (token->text) {
-                    strncpy(token->text, start, len);
-                    token->text[len] = '\0';
-
-                    // check if it's a command first
-                    const Command cmd = get_command(token->text);
-                    if (cmd != CMD_UNKNOWN) {
-                        token->type = TOKEN_COMMAND;
-                        token->command = cmd;
-                    } else {
-                        // check if it's an operator (MOD, AND, OR, NOT)
-                        const Operator op = get_operator(token->text);
-                        if (op != OP_UNKNOWN) {
-                            token->type = TOKEN_OPERATOR;
-                            token->operator = op;
-                        } else {
-                            // check if it's a function
-                            const Function func = get_function(token->text);
-                            if (func != FUNC_UNKNOWN) {
-                                token->type = TOKEN_FUNCTION;
-                                token->function = func;
-                            } else {
-                                // default to variable
-                                token->type = TOKEN_VARIABLE;
-                            }
+                    // one perfect-hash probe classifies commands, word operators and functions
+                    const Keyword *keyword = find_keyword(start, (size_t)len);
+                    if (keyword) {
+                        token->type = keyword->type;
+                        switch (keyword->type) {
+                            case TOKEN_COMMAND:
+                                token->command = (Command)keyword->value;
+                                break;
+                            case TOKEN_OPERATOR:
+                                token->operator = (Operator)keyword->value;
+                                break;
+                            default:
+                                token->function = (Function)keyword->value;
+                                break;
                         }
+                    } else {
+                        token->type = TOKEN_VARIABLE;
                     }
                 }
             } else {
@@ -174,19 +178,11 @@ Token *tokenize(const char *text, int *token_count) {
         }
     }
 
-    return tokens;
-}
-
-void cleanup_tokens(Token *tokens, int token_count) {
-    if (!tokens || token_count <= 0) return;
-    
-    for (int i = 0; i < token_count; i++) {
-        if (tokens[i].text) {
-            free(tokens[i].text);
-            tokens[i].text = NULL;
-        }
-        cleanup_value(&tokens[i].value);
+    Token *result = arena_alloc(arena, sizeof(Token) * (*token_count));
+    if (!result) {
+        *token_count = 0;
+        return NULL;
     }
-    
-    free(tokens);
-}
\ No newline at end of file
+    memcpy(result, tokens, sizeof(Token) * (*token_count));
+    return result;
+}
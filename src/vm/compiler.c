@@ -0,0 +1,537 @@
+#include "interpreter/basic_interpreter.h"
+
+#define MAX_INLINE_NODES 16 // DEF FN bodies up to this size are copied into each call
+
+// a DEF statement whose body is compiled after the program code
+typedef struct pending_body_t {
+    const Statement *definition;
+    int patch; // where BC_DEF takes the body's code offset
+} PendingBody;
+
+typedef struct compiler_t {
+    Interpreter *interp;
+    Bytecode *bc;
+    int depth;
+    int failed;
+    int param_base; // stack depth of the first argument of an inlined call, -1 in a called body
+    const Statement **single_definitions; // per function: its DEF when the program has exactly one
+    int *inlining; // per function: its body is being inlined, so it is not inlined into itself
+    PendingBody *bodies;
+    int body_count;
+    int body_capacity;
+} Compiler;
+
+static void emit(Compiler *c, int word) {
+    Bytecode *bc = c->bc;
+    if (bc->code_count >= bc->code_capacity) {
+        int capacity = bc->code_capacity ? bc->code_capacity * 2 : 256;
+        int *code = realloc(bc->code, sizeof(int) * capacity);
+        if (!code) {
+            c->failed = 1;
+            return;
+        }
+        bc->code = code;
+        bc->code_capacity = capacity;
+    }
+    bc->code[bc->code_count++] = word;
+}
+
+static void adjust_depth(Compiler *c, int delta) {
+    c->depth += delta;
+    if (c->depth > c->bc->max_stack) {
+        c->bc->max_stack = c->depth;
+    }
+}
+
+static int add_constant(Compiler *c, const Value *value) {
+    Bytecode *bc = c->bc;
+    if (bc->constant_count >= bc->constant_capacity) {
+        int capacity = bc->constant_capacity ? bc->constant_capacity * 2 : 64;
+        Value *constants = realloc(bc->constants, sizeof(Value) * capacity);
+        if (!constants) {
+            c->failed = 1;
+            return 0;
+        }
+        bc->constants = constants;
+        bc->constant_capacity = capacity;
+    }
+
+    // string literals are immortal and owned by the program arena, they are shared
+    bc->constants[bc->constant_count] = retain_value(*value);
+    return bc->constant_count++;
+}
+
+// symbols are prompts and error messages owned by the statement trees
+static int add_symbol(Compiler *c, const char *symbol) {
+    Bytecode *bc = c->bc;
+    if (bc->symbol_count >= bc->symbol_capacity) {
+        int capacity = bc->symbol_capacity ? bc->symbol_capacity * 2 : 64;
+        const char **symbols = realloc(bc->symbols, sizeof(char *) * capacity);
+        if (!symbols) {
+            c->failed = 1;
+            return 0;
+        }
+        bc->symbols = symbols;
+        bc->symbol_capacity = capacity;
+    }
+    bc->symbols[bc->symbol_count] = symbol;
+    return bc->symbol_count++;
+}
+
+static void emit_error(Compiler *c, const char *message) {
+    emit(c, BC_ERROR);
+    emit(c, add_symbol(c, message));
+}
+
+static void emit_jump(Compiler *c, BytecodeOp op, const Statement *stmt) {
+    const int line_index = stmt->target_index;
+    if (line_index == -1) {
+        // only an error if the jump is actually taken
+        emit_error(c, "Line number not found");
+        return;
+    }
+    emit(c, op);
+    emit(c, line_index);
+}
+
+static void compile_subscripts(Compiler *c, const Node *node);
+static void compile_expression(Compiler *c, const Node *node);
+
+static int count_nodes(const Node *node) {
+    if (!node) return 0;
+    int count = 1 + count_nodes(node->left) + count_nodes(node->right);
+    for (int i = 0; i < node->arg_count; i++) {
+        count += count_nodes(node->args[i]);
+    }
+    return count;
+}
+
+// parameters convert like variables of the same name, the result like a variable named after the function
+static void compile_coercions(Compiler *c, const Statement *definition) {
+    const Node *function = definition->target;
+    for (int i = 0; i < function->arg_count; i++) {
+        emit(c, BC_COERCE);
+        emit(c, function->arg_count - i);
+        emit(c, is_integer_name(function->args[i]->name));
+    }
+}
+
+// FNA(x, y): a small body with a single DEF is copied in place, reading its
+// arguments from the stack, otherwise it is called as code after the program
+static void compile_user_call(Compiler *c, const Node *node) {
+    compile_subscripts(c, node);
+
+    const Statement *definition = c->single_definitions[node->slot];
+    if (!definition || c->inlining[node->slot] || definition->target->arg_count != node->arg_count ||
+        count_nodes(definition->expr) > MAX_INLINE_NODES) {
+        emit(c, BC_CALL_FN);
+        emit(c, node->slot);
+        emit(c, node->arg_count);
+        adjust_depth(c, 1 - node->arg_count);
+        return;
+    }
+
+    // the DEF may not have run yet
+    emit(c, BC_CHECK_FN);
+    emit(c, node->slot);
+
+    const int caller_base = c->param_base;
+    c->param_base = c->depth - node->arg_count;
+    compile_coercions(c, definition);
+    c->inlining[node->slot] = 1;
+    compile_expression(c, definition->expr);
+    c->inlining[node->slot] = 0;
+    c->param_base = caller_base;
+
+    emit(c, BC_COERCE);
+    emit(c, 1);
+    emit(c, is_integer_name(node->name));
+    emit(c, BC_DROP_UNDER);
+    emit(c, node->arg_count);
+    adjust_depth(c, -node->arg_count);
+}
+
+static void compile_expression(Compiler *c, const Node *node) {
+    if (!node) {
+        emit_error(c, "Invalid expression");
+        adjust_depth(c, 1);
+        return;
+    }
+
+    switch (node->type) {
+        case NODE_NUMBER:
+        case NODE_STRING:
+            emit(c, BC_CONST);
+            emit(c, add_constant(c, &node->value));
+            adjust_depth(c, 1);
+            break;
+        case NODE_VARIABLE:
+            emit(c, BC_LOAD_VAR);
+            emit(c, node->slot);
+            adjust_depth(c, 1);
+            break;
+        case NODE_UNARY:
+            compile_expression(c, node->left);
+            emit(c, BC_UNARY);
+            emit(c, node->op);
+            break;
+        case NODE_BINARY:
+            compile_expression(c, node->left);
+            compile_expression(c, node->right);
+            emit(c, BC_BINARY);
+            emit(c, node->op);
+            adjust_depth(c, -1);
+            break;
+        case NODE_FUNCTION:
+            for (int i = 0; i < node->arg_count; i++) {
+                compile_expression(c, node->args[i]);
+            }
+            emit(c, BC_CALL);
+            emit(c, node->function);
+            emit(c, node->arg_count);
+            adjust_depth(c, 1 - node->arg_count);
+            break;
+        case NODE_ARRAY:
+            compile_subscripts(c, node);
+            emit(c, BC_LOAD_ELEMENT);
+            emit(c, node->slot);
+            emit(c, node->arg_count);
+            adjust_depth(c, 1 - node->arg_count);
+            break;
+        case NODE_PARAM:
+            if (c->param_base >= 0) {
+                emit(c, BC_PICK);
+                emit(c, c->depth - (c->param_base + node->slot));
+            } else {
+                emit(c, BC_LOAD_PARAM);
+                emit(c, node->slot);
+            }
+            adjust_depth(c, 1);
+            break;
+        case NODE_FN_CALL:
+            compile_user_call(c, node);
+            break;
+    }
+}
+
+static void compile_subscripts(Compiler *c, const Node *node) {
+    for (int i = 0; i < node->arg_count; i++) {
+        compile_expression(c, node->args[i]);
+    }
+}
+
+static void compile_statement(Compiler *c, const Statement *stmt) {
+    if (stmt->error) {
+        emit_error(c, stmt->error);
+        return;
+    }
+
+    switch (stmt->command) {
+        case CMD_PRINT:
+            for (int i = 0; i < stmt->item_count; i++) {
+                if (stmt->items[i].expr) {
+                    compile_expression(c, stmt->items[i].expr);
+                    emit(c, BC_PRINT);
+                    adjust_depth(c, -1);
+                }
+                if (stmt->items[i].separator == ',') {
+                    emit(c, BC_PRINT_TAB);
+                }
+            }
+            break;
+        case CMD_LET:
+            if (stmt->operand_count > 0) {
+                for (int i = 0; i < stmt->operand_count; i++) {
+                    compile_expression(c, stmt->operands[i]);
+                }
+                emit(c, BC_APPEND_VAR);
+                emit(c, stmt->target->slot);
+                emit(c, stmt->operand_count);
+                adjust_depth(c, -stmt->operand_count);
+                break;
+            }
+            if (stmt->target->type == NODE_ARRAY) {
+                compile_subscripts(c, stmt->target);
+                compile_expression(c, stmt->expr);
+                emit(c, BC_STORE_ELEMENT);
+                emit(c, stmt->target->slot);
+                emit(c, stmt->target->arg_count);
+                adjust_depth(c, -1 - stmt->target->arg_count);
+                break;
+            }
+            compile_expression(c, stmt->expr);
+            emit(c, BC_STORE_VAR);
+            emit(c, stmt->target->slot);
+            adjust_depth(c, -1);
+            break;
+        case CMD_INPUT: {
+            const int prompt = stmt->prompt ? add_symbol(c, stmt->prompt) : -1;
+            for (int i = 0; i < stmt->operand_count; i++) {
+                const Node *target = stmt->operands[i];
+                if (target->type == NODE_ARRAY) {
+                    compile_subscripts(c, target);
+                    emit(c, BC_INPUT_ELEMENT);
+                } else {
+                    emit(c, BC_INPUT);
+                }
+                emit(c, target->slot);
+                emit(c, prompt);
+                emit(c, i);
+                emit(c, stmt->operand_count);
+                if (target->type == NODE_ARRAY) {
+                    emit(c, target->arg_count);
+                    adjust_depth(c, -target->arg_count);
+                }
+            }
+            break;
+        }
+        case CMD_DIM:
+            for (int i = 0; i < stmt->operand_count; i++) {
+                const Node *array = stmt->operands[i];
+                compile_subscripts(c, array);
+                emit(c, BC_DIM);
+                emit(c, array->slot);
+                emit(c, array->arg_count);
+                adjust_depth(c, -array->arg_count);
+            }
+            break;
+        case CMD_MAT: {
+            int count = 0;
+            if (stmt->expr) {
+                compile_expression(c, stmt->expr);
+                count = 1;
+            } else if (stmt->target->type == NODE_ARRAY) {
+                compile_subscripts(c, stmt->target);
+                count = stmt->target->arg_count;
+            }
+            emit(c, BC_MAT);
+            emit(c, stmt->mat_op);
+            emit(c, stmt->target->slot);
+            emit(c, stmt->operand_count > 0 ? stmt->operands[0]->slot : -1);
+            emit(c, stmt->operand_count > 1 ? stmt->operands[1]->slot : -1);
+            emit(c, count);
+            adjust_depth(c, -count);
+            break;
+        }
+        case CMD_READ:
+            for (int i = 0; i < stmt->operand_count; i++) {
+                const Node *target = stmt->operands[i];
+                if (target->type == NODE_ARRAY) {
+                    compile_subscripts(c, target);
+                    emit(c, BC_READ_ELEMENT);
+                    emit(c, target->slot);
+                    emit(c, target->arg_count);
+                    adjust_depth(c, -target->arg_count);
+                } else {
+                    emit(c, BC_READ);
+                    emit(c, target->slot);
+                }
+            }
+            break;
+        case CMD_RESTORE:
+            if (stmt->target_line >= 0) {
+                emit_jump(c, BC_RESTORE, stmt);
+            } else {
+                emit(c, BC_RESTORE);
+                emit(c, -1);
+            }
+            break;
+        case CMD_DEF:
+            if (c->body_count >= c->body_capacity) {
+                PendingBody *bodies = grow_array(c->bodies, &c->body_capacity, sizeof(PendingBody));
+                if (!bodies) {
+                    c->failed = 1;
+                    break;
+                }
+                c->bodies = bodies;
+            }
+            emit(c, BC_DEF);
+            emit(c, stmt->target->slot);
+            c->bodies[c->body_count].definition = stmt;
+            c->bodies[c->body_count++].patch = c->bc->code_count;
+            emit(c, 0);
+            emit(c, stmt->target->arg_count);
+            emit(c, c->body_count - 1);
+            break;
+        case CMD_IF: {
+            compile_expression(c, stmt->expr);
+            emit(c, BC_JUMP_IF_FALSE);
+            const int patch = c->bc->code_count;
+            emit(c, 0);
+            adjust_depth(c, -1);
+
+            if (stmt->then_statement) {
+                compile_statement(c, stmt->then_statement);
+            } else if (stmt->target_line >= 0) {
+                emit_jump(c, BC_GOTO, stmt);
+            }
+            if (!c->failed) {
+                c->bc->code[patch] = c->bc->code_count;
+            }
+            break;
+        }
+        case CMD_FOR: {
+            compile_expression(c, stmt->expr);
+            compile_expression(c, stmt->end_expr);
+            if (stmt->step_expr) {
+                compile_expression(c, stmt->step_expr);
+            } else {
+                const Value one = create_number_value(1.0);
+                emit(c, BC_CONST);
+                emit(c, add_constant(c, &one));
+                adjust_depth(c, 1);
+            }
+            emit(c, BC_FOR);
+            emit(c, stmt->target->slot);
+            adjust_depth(c, -3);
+            break;
+        }
+        case CMD_NEXT:
+            emit(c, BC_NEXT);
+            break;
+        case CMD_GOTO:
+            emit_jump(c, BC_GOTO, stmt);
+            break;
+        case CMD_GOSUB:
+            emit_jump(c, BC_GOSUB, stmt);
+            break;
+        case CMD_ON:
+            // unresolved targets are only an error if they are taken
+            compile_expression(c, stmt->expr);
+            emit(c, stmt->on_command == CMD_GOSUB ? BC_ON_GOSUB : BC_ON_GOTO);
+            emit(c, stmt->target_count);
+            for (int i = 0; i < stmt->target_count; i++) {
+                emit(c, stmt->target_indices[i]);
+            }
+            adjust_depth(c, -1);
+            break;
+        case CMD_RETURN:
+            emit(c, BC_RETURN);
+            break;
+        case CMD_END:
+        case CMD_STOP:
+            emit(c, BC_END);
+            break;
+        case CMD_REM:
+        case CMD_DATA:
+            break;
+        default:
+            emit_error(c, "Unknown command");
+            break;
+    }
+}
+
+void free_bytecode(Bytecode *bytecode) {
+    if (!bytecode) return;
+
+    for (int i = 0; i < bytecode->constant_count; i++) {
+        cleanup_value(&bytecode->constants[i]);
+    }
+    free(bytecode->constants);
+    free(bytecode->symbols);
+    free(bytecode->definitions);
+    if (!bytecode->borrowed) {
+        free(bytecode->code);
+        free(bytecode->line_offsets);
+    }
+    free(bytecode);
+}
+
+void invalidate_bytecode(Interpreter *interp) {
+    if (!interp) return;
+
+    free_bytecode(interp->bytecode);
+    interp->bytecode = NULL;
+}
+
+static void count_definitions(Compiler *c, const Statement *stmt, int *counts) {
+    for (; stmt; stmt = stmt->then_statement) {
+        if (stmt->command == CMD_DEF && !stmt->error) {
+            counts[stmt->target->slot]++;
+            c->single_definitions[stmt->target->slot] = stmt;
+        }
+    }
+}
+
+// a function with one DEF in the whole program can only ever be bound to that body
+static int find_single_definitions(Compiler *c) {
+    const int count = c->interp->function_count;
+    c->single_definitions = calloc((size_t)count + 1, sizeof(Statement *));
+    c->inlining = calloc((size_t)count + 1, sizeof(int));
+    int *counts = calloc((size_t)count + 1, sizeof(int));
+    if (!c->single_definitions || !c->inlining || !counts) {
+        free(c->single_definitions);
+        free(c->inlining);
+        free(counts);
+        return 0;
+    }
+
+    for (int i = 0; i < c->interp->line_count; i++) {
+        count_definitions(c, c->interp->lines[i].statement, counts);
+    }
+    for (int i = 0; i < count; i++) {
+        if (counts[i] != 1) c->single_definitions[i] = NULL;
+    }
+    free(counts);
+    return 1;
+}
+
+Bytecode *compile_program(Interpreter *interp) {
+    if (!interp) return NULL;
+
+    Bytecode *bc = calloc(1, sizeof(Bytecode));
+    if (!bc) return NULL;
+
+    bc->line_count = interp->line_count;
+    bc->line_offsets = malloc(sizeof(int) * (interp->line_count + 1));
+    if (!bc->line_offsets) {
+        free_bytecode(bc);
+        return NULL;
+    }
+
+    Compiler compiler = {interp, bc, 0, 0, -1, NULL, NULL, NULL, 0, 0};
+    if (!find_single_definitions(&compiler)) {
+        free_bytecode(bc);
+        return NULL;
+    }
+    for (int i = 0; i < interp->line_count && !compiler.failed; i++) {
+        bc->line_offsets[i] = bc->code_count;
+        emit(&compiler, BC_LINE);
+        emit(&compiler, i);
+        if (interp->lines[i].statement) {
+            compile_statement(&compiler, interp->lines[i].statement);
+        }
+    }
+
+    // falling off the last line ends the program
+    bc->line_offsets[interp->line_count] = bc->code_count;
+    emit(&compiler, BC_END);
+
+    // each DEF body runs on top of its arguments and returns to the caller
+    for (int i = 0; i < compiler.body_count && !compiler.failed; i++) {
+        const Statement *definition = compiler.bodies[i].definition;
+        bc->code[compiler.bodies[i].patch] = bc->code_count;
+        compiler.depth = 0;
+        compile_coercions(&compiler, definition);
+        compile_expression(&compiler, definition->expr);
+        emit(&compiler, BC_COERCE);
+        emit(&compiler, 1);
+        emit(&compiler, is_integer_name(definition->target->name));
+        emit(&compiler, BC_RETURN_FN);
+    }
+    bc->function_count = interp->function_count;
+    bc->definitions = malloc(sizeof(Statement *) * ((size_t)compiler.body_count + 1));
+    if (!bc->definitions) compiler.failed = 1;
+    for (int i = 0; i < compiler.body_count && !compiler.failed; i++) {
+        bc->definitions[i] = compiler.bodies[i].definition;
+    }
+    free(compiler.single_definitions);
+    free(compiler.inlining);
+    free(compiler.bodies);
+
+    if (compiler.failed) {
+        free_bytecode(bc);
+        return NULL;
+    }
+    return bc;
+}
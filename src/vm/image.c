@@ -0,0 +1,641 @@
+#include "interpreter/basic_interpreter.h"
+#include <stdint.h>
+#include <sys/stat.h>
+
+// a program image is the compiled bytecode of a program plus what the VM
+// needs around it: line numbers and text, variable names, constants and
+// symbols. it is written by --compile next to the source (prog.bas ->
+// prog.basc) and mapped read-only when run, so code and line offsets are
+// used in place without a parse phase.
+//
+// layout: header, then int32 sections (line numbers, line texts, line
+// offsets, code, variable names, symbols), the constants and a pool of
+// NUL-terminated strings; every section starts 8-byte aligned. strings
+// are referenced by their offset in the pool.
+
+#define IMAGE_MAGIC "BASICIMG"
+#define IMAGE_VERSION 7
+
+typedef struct image_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t word_size; // sizeof(int), images are only read by the build that wrote them
+    int64_t source_size;
+    int64_t source_mtime_ns;
+    int32_t line_count;
+    int32_t variable_count;
+    int32_t code_count;
+    int32_t constant_count;
+    int32_t symbol_count;
+    int32_t max_stack;
+    uint32_t pool_size;
+    int32_t function_count; // DEF FN slots, bound when the program runs
+} ImageHeader;
+
+typedef struct image_constant_t {
+    int32_t type;
+    uint32_t string;
+    uint32_t length;
+    uint32_t reserved;
+    double number;
+    int64_t integer;
+} ImageConstant;
+
+typedef struct image_layout_t {
+    size_t line_numbers;
+    size_t line_texts;
+    size_t line_offsets;
+    size_t code;
+    size_t variables;
+    size_t symbols;
+    size_t constants;
+    size_t pool;
+    size_t size;
+} ImageLayout;
+
+typedef struct string_pool_t {
+    char *data;
+    size_t size;
+    size_t capacity;
+} StringPool;
+
+static size_t align8(size_t offset) {
+    return (offset + 7) & ~(size_t)7;
+}
+
+static void compute_layout(const ImageHeader *header, ImageLayout *layout) {
+    size_t offset = align8(sizeof(ImageHeader));
+    layout->line_numbers = offset;
+    offset = align8(offset + sizeof(int32_t) * (size_t)header->line_count);
+    layout->line_texts = offset;
+    offset = align8(offset + sizeof(int32_t) * (size_t)header->line_count);
+    layout->line_offsets = offset;
+    offset = align8(offset + sizeof(int32_t) * ((size_t)header->line_count + 1));
+    layout->code = offset;
+    offset = align8(offset + sizeof(int32_t) * (size_t)header->code_count);
+    layout->variables = offset;
+    offset = align8(offset + sizeof(int32_t) * (size_t)header->variable_count);
+    layout->symbols = offset;
+    offset = align8(offset + sizeof(int32_t) * (size_t)header->symbol_count);
+    layout->constants = offset;
+    offset = align8(offset + sizeof(ImageConstant) * (size_t)header->constant_count);
+    layout->pool = offset;
+    layout->size = offset + header->pool_size;
+}
+
+// nanoseconds, so an edit within the second the image was written still shows
+static int64_t modified_ns(const struct stat *info) {
+#if defined(_WIN32)
+    return (int64_t)info->st_mtime * 1000000000;
+#elif defined(__APPLE__)
+    return (int64_t)info->st_mtimespec.tv_sec * 1000000000 + info->st_mtimespec.tv_nsec;
+#else
+    return (int64_t)info->st_mtim.tv_sec * 1000000000 + info->st_mtim.tv_nsec;
+#endif
+}
+
+// the source of prog.basc is prog.bas
+static int image_source_path(const char *image_path, char *buffer, size_t size) {
+    const size_t length = strlen(image_path);
+    if (length < 2 || length >= size || (image_path[length - 1] != 'c' && image_path[length - 1] != 'C')) {
+        return 0;
+    }
+    memcpy(buffer, image_path, length - 1);
+    buffer[length - 1] = '\0';
+    return 1;
+}
+
+static uint32_t pool_add(StringPool *pool, const char *text, size_t length, int *failed) {
+    if (pool->size + length + 1 > pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity * 2 : 4096;
+        while (capacity < pool->size + length + 1) capacity *= 2;
+        char *data = realloc(pool->data, capacity);
+        if (!data) {
+            *failed = 1;
+            return 0;
+        }
+        pool->data = data;
+        pool->capacity = capacity;
+    }
+
+    const uint32_t offset = (uint32_t)pool->size;
+    memcpy(pool->data + pool->size, text, length);
+    pool->data[pool->size + length] = '\0';
+    pool->size += length + 1;
+    return offset;
+}
+
+static uint32_t pool_add_string(StringPool *pool, const char *text, int *failed) {
+    return pool_add(pool, text ? text : "", text ? strlen(text) : 0, failed);
+}
+
+static void write_section(FILE *file, const void *data, size_t size, size_t offset, int *failed) {
+    // pad up to the section start
+    static const char zeros[8] = {0};
+    long position = ftell(file);
+    while (position >= 0 && (size_t)position < offset) {
+        const size_t pad = offset - (size_t)position > sizeof(zeros) ? sizeof(zeros) : offset - (size_t)position;
+        if (fwrite(zeros, 1, pad, file) != pad) *failed = 1;
+        position += (long)pad;
+    }
+    if (size > 0 && fwrite(data, 1, size, file) != size) *failed = 1;
+}
+
+int is_program_image(const char *filename) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    char magic[sizeof(((ImageHeader *)0)->magic)];
+    const int is_image = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                         memcmp(magic, IMAGE_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return is_image;
+}
+
+int write_program_image(Interpreter *interp, const char *image_path, const char *source_path) {
+    if (!interp || !image_path || !source_path) return 0;
+
+    resolve_program(interp);
+    if (!interp->bytecode) {
+        interp->bytecode = compile_program(interp);
+        if (!interp->bytecode) {
+            print_error(interp, "Bytecode compilation failed");
+            return 0;
+        }
+    }
+    const Bytecode *bc = interp->bytecode;
+
+    struct stat info;
+    if (stat(source_path, &info) != 0) {
+        printf("Error: Cannot stat file %s\n", source_path);
+        return 0;
+    }
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.word_size = sizeof(int);
+    header.source_size = (int64_t)info.st_size;
+    header.source_mtime_ns = modified_ns(&info);
+    header.line_count = interp->line_count;
+    header.variable_count = interp->variable_count;
+    header.code_count = bc->code_count;
+    header.constant_count = bc->constant_count;
+    header.symbol_count = bc->symbol_count;
+    header.max_stack = bc->max_stack;
+    header.function_count = bc->function_count;
+
+    int failed = 0;
+    StringPool pool = {NULL, 0, 0};
+    int32_t *line_numbers = malloc(sizeof(int32_t) * (interp->line_count + 1));
+    int32_t *line_texts = malloc(sizeof(int32_t) * (interp->line_count + 1));
+    int32_t *variables = malloc(sizeof(int32_t) * (interp->variable_count + 1));
+    int32_t *symbols = malloc(sizeof(int32_t) * (bc->symbol_count + 1));
+    ImageConstant *constants = calloc((size_t)bc->constant_count + 1, sizeof(ImageConstant));
+    if (!line_numbers || !line_texts || !variables || !symbols || !constants) {
+        failed = 1;
+    }
+
+    for (int i = 0; i < interp->line_count && !failed; i++) {
+        line_numbers[i] = interp->lines[i].line_number;
+        line_texts[i] = (int32_t)pool_add_string(&pool, interp->lines[i].text, &failed);
+    }
+    for (int i = 0; i < interp->variable_count && !failed; i++) {
+        variables[i] = (int32_t)pool_add_string(&pool, interp->variables[i].name, &failed);
+    }
+    for (int i = 0; i < bc->symbol_count && !failed; i++) {
+        symbols[i] = (int32_t)pool_add_string(&pool, bc->symbols[i], &failed);
+    }
+    for (int i = 0; i < bc->constant_count && !failed; i++) {
+        const Value *value = &bc->constants[i];
+        constants[i].type = value->type;
+        if (value->type == VALUE_STRING) {
+            constants[i].string = pool_add(&pool, value->data.string->data, value->data.string->length, &failed);
+            constants[i].length = (uint32_t)value->data.string->length;
+        } else if (value->type == VALUE_INTEGER) {
+            constants[i].integer = value->data.integer;
+        } else {
+            constants[i].number = value->data.number;
+        }
+    }
+    header.pool_size = (uint32_t)pool.size;
+
+    FILE *file = failed ? NULL : fopen(image_path, "wb");
+    if (file) {
+        ImageLayout layout;
+        compute_layout(&header, &layout);
+        write_section(file, &header, sizeof(header), 0, &failed);
+        write_section(file, line_numbers, sizeof(int32_t) * interp->line_count, layout.line_numbers, &failed);
+        write_section(file, line_texts, sizeof(int32_t) * interp->line_count, layout.line_texts, &failed);
+        write_section(file, bc->line_offsets, sizeof(int32_t) * (interp->line_count + 1), layout.line_offsets, &failed);
+        write_section(file, bc->code, sizeof(int32_t) * bc->code_count, layout.code, &failed);
+        write_section(file, variables, sizeof(int32_t) * interp->variable_count, layout.variables, &failed);
+        write_section(file, symbols, sizeof(int32_t) * bc->symbol_count, layout.symbols, &failed);
+        write_section(file, constants, sizeof(ImageConstant) * bc->constant_count, layout.constants, &failed);
+        write_section(file, pool.data, pool.size, layout.pool, &failed);
+        if (fclose(file) != 0) failed = 1;
+    } else {
+        failed = 1;
+    }
+
+    free(line_numbers);
+    free(line_texts);
+    free(variables);
+    free(symbols);
+    free(constants);
+    free(pool.data);
+
+    if (failed) {
+        printf("Error: Cannot write image %s\n", image_path);
+        remove(image_path);
+        return 0;
+    }
+    return 1;
+}
+
+static int in_range(int value, int count) {
+    return value >= 0 && value < count;
+}
+
+// the VM trusts its operands, so an image is checked instruction by
+// instruction before it runs: opcodes, slots, line indices, and the stack
+// depth along every path. jumps and DEF bodies only go forward, so one
+// pass sees the depth a target is entered with before it reaches it.
+// code after an END, GOTO, GOSUB, RETURN or ERROR is only entered through
+// a line, a jump or a call, until then its depth is unknown (-1).
+static int validate_code(const int *code, const int *line_offsets, const ImageHeader *header) {
+    const int count = header->code_count;
+    const int lines = header->line_count;
+    const int variables = header->variable_count;
+    const int main_end = line_offsets[lines]; // the END after the last line, DEF bodies follow it
+    if (!in_range(main_end, count) || code[main_end] != BC_END) return 0;
+
+    char *starts = calloc((size_t)count, 1);
+    int *entries = malloc(sizeof(int) * (size_t)count); // the depth a jump or call enters with
+    if (!starts || !entries) {
+        free(starts);
+        free(entries);
+        return 0;
+    }
+    for (int i = 0; i < count; i++) entries[i] = -1;
+
+    int valid = 1;
+    int depth = 0;
+    int params = -1; // arguments of the body being checked, -1 in the program
+    int pc = 0;
+    while (pc < count && valid) {
+        const int op = code[pc];
+        int operand[5] = {-1, -1, -1, -1, -1}; // -1 past the end of the code
+        for (int i = 0; i < 5 && pc + 1 + i < count; i++) operand[i] = code[pc + 1 + i];
+        const int body = pc > main_end;
+        int size = 1; // words, the opcode included
+        int pops = 0;
+        int pushes = 0;
+        int ends = 0; // control does not fall through
+        int jumps = 0; // to the start of a line, where nothing is left on the stack
+        starts[pc] = 1;
+        if (entries[pc] >= 0) {
+            if (!body && depth >= 0 && depth != entries[pc]) break;
+            depth = entries[pc];
+            if (body) params = entries[pc];
+        }
+
+        switch (op) {
+            case BC_LINE:
+                size = 2;
+                valid = !body && depth <= 0 && in_range(operand[0], lines);
+                depth = 0;
+                break;
+            case BC_CONST:
+                size = 2;
+                pushes = 1;
+                valid = in_range(operand[0], header->constant_count);
+                break;
+            case BC_LOAD_VAR:
+                size = 2;
+                pushes = 1;
+                valid = in_range(operand[0], variables);
+                break;
+            case BC_STORE_VAR:
+            case BC_FOR:
+            case BC_READ:
+                size = 2;
+                pops = op == BC_STORE_VAR ? 1 : op == BC_FOR ? 3 : 0;
+                valid = !body && in_range(operand[0], variables);
+                break;
+            case BC_APPEND_VAR:
+            case BC_DIM:
+            case BC_READ_ELEMENT:
+                size = 3;
+                pops = operand[1];
+                valid = !body && in_range(operand[0], variables);
+                break;
+            case BC_LOAD_ELEMENT:
+                size = 3;
+                pops = operand[1];
+                pushes = 1;
+                valid = in_range(operand[0], variables);
+                break;
+            case BC_STORE_ELEMENT:
+                size = 3;
+                pops = operand[1] + 1;
+                valid = !body && in_range(operand[0], variables) && operand[1] >= 0;
+                break;
+            case BC_UNARY:
+            case BC_BINARY:
+                size = 2;
+                pops = op == BC_UNARY ? 1 : 2;
+                pushes = 1;
+                valid = in_range(operand[0], OP_UNKNOWN);
+                break;
+            case BC_CALL:
+                size = 3;
+                pops = operand[1];
+                pushes = 1;
+                valid = in_range(operand[0], FUNC_UNKNOWN);
+                break;
+            case BC_PRINT:
+                pops = 1;
+                valid = !body;
+                break;
+            case BC_PRINT_TAB:
+                valid = !body;
+                break;
+            case BC_NEXT:
+                jumps = 1;
+                valid = !body;
+                break;
+            case BC_INPUT:
+            case BC_INPUT_ELEMENT:
+                size = op == BC_INPUT ? 5 : 6;
+                pops = op == BC_INPUT ? 0 : operand[4];
+                valid = !body && in_range(operand[0], variables) &&
+                        (operand[1] == -1 || in_range(operand[1], header->symbol_count)) && in_range(operand[2], operand[3]);
+                break;
+            case BC_MAT:
+                size = 6;
+                pops = operand[4];
+                valid = !body && in_range(operand[0], MAT_TRN + 1) && in_range(operand[1], variables) &&
+                        (operand[2] == -1 || in_range(operand[2], variables)) &&
+                        (operand[3] == -1 || in_range(operand[3], variables));
+                break;
+            case BC_JUMP_IF_FALSE:
+                size = 2;
+                pops = 1;
+                valid = !body && operand[0] > pc && operand[0] <= main_end;
+                break;
+            case BC_GOTO:
+            case BC_GOSUB:
+                size = 2;
+                ends = 1;
+                jumps = 1;
+                valid = !body && in_range(operand[0], lines);
+                break;
+            case BC_ON_GOTO:
+            case BC_ON_GOSUB:
+                size = 2 + operand[0];
+                pops = 1;
+                jumps = 1;
+                valid = !body && operand[0] >= 0 && operand[0] <= count - pc - 2;
+                for (int i = 0; valid && i < operand[0]; i++) {
+                    const int line = code[pc + 2 + i];
+                    valid = line == -1 || in_range(line, lines);
+                }
+                break;
+            case BC_RESTORE:
+                size = 2;
+                valid = !body && (operand[0] == -1 || in_range(operand[0], lines));
+                break;
+            case BC_RETURN:
+            case BC_END:
+                ends = 1;
+                jumps = op == BC_RETURN;
+                valid = !body;
+                break;
+            case BC_ERROR:
+                size = 2;
+                ends = 1;
+                valid = in_range(operand[0], header->symbol_count);
+                break;
+            case BC_DEF:
+                size = 5;
+                valid = !body && in_range(operand[0], header->function_count) && operand[1] > main_end &&
+                        operand[1] < count && in_range(operand[2], count) &&
+                        (entries[operand[1]] == -1 || entries[operand[1]] == operand[2]) && operand[3] >= 0;
+                if (valid) entries[operand[1]] = operand[2];
+                break;
+            case BC_CHECK_FN:
+                size = 2;
+                valid = in_range(operand[0], header->function_count);
+                break;
+            case BC_CALL_FN:
+                size = 3;
+                pops = operand[1];
+                pushes = 1;
+                valid = in_range(operand[0], header->function_count);
+                break;
+            case BC_RETURN_FN:
+                pops = 1;
+                ends = 1;
+                valid = body;
+                break;
+            case BC_LOAD_PARAM:
+                size = 2;
+                pushes = 1;
+                valid = body && in_range(operand[0], params);
+                break;
+            case BC_PICK:
+                size = 2;
+                pushes = 1;
+                valid = operand[0] >= 1 && (depth < 0 || operand[0] <= depth);
+                break;
+            case BC_DROP_UNDER:
+                size = 2;
+                pops = operand[0] + 1;
+                pushes = 1;
+                break;
+            case BC_COERCE:
+                size = 3;
+                valid = operand[0] >= 1 && (depth < 0 || operand[0] <= depth) && (operand[1] == 0 || operand[1] == 1);
+                break;
+            default:
+                valid = 0;
+                break;
+        }
+        if (!valid || size > count - pc || pops < 0) break;
+
+        if (depth >= 0) {
+            if (depth < pops) break;
+            depth += pushes - pops;
+            if (depth > (body ? params + header->max_stack : header->max_stack) || (jumps && depth > 0)) break;
+        }
+        if (op == BC_JUMP_IF_FALSE && depth >= 0) {
+            if (entries[operand[0]] >= 0 && entries[operand[0]] != depth) break;
+            entries[operand[0]] = depth;
+        }
+        if (ends) depth = -1;
+        pc += size;
+    }
+    valid = valid && pc == count && depth == -1;
+
+    // every line starts with its own BC_LINE, and every target is an instruction
+    for (int i = 0; i < lines && valid; i++) {
+        valid = in_range(line_offsets[i], count) && starts[line_offsets[i]] && code[line_offsets[i]] == BC_LINE &&
+                code[line_offsets[i] + 1] == i;
+    }
+    for (int i = 0; i < count && valid; i++) {
+        valid = entries[i] == -1 || starts[i];
+    }
+    free(starts);
+    free(entries);
+    return valid;
+}
+
+// 0 when the image is unusable or older than its source
+static int map_program_image(Interpreter *interp, const char *image_path) {
+    if (interp->line_count > 0 || interp->variable_count > 0) {
+        print_error(interp, "Images can only be loaded into an empty interpreter");
+        return 0;
+    }
+
+    MappedFile image;
+    if (!map_file(image_path, &image)) {
+        printf("Error: Cannot open file %s\n", image_path);
+        return 0;
+    }
+
+    ImageHeader header;
+    ImageLayout layout;
+    if (image.size < sizeof(header)) goto invalid;
+    memcpy(&header, image.data, sizeof(header));
+    if (memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != IMAGE_VERSION || header.word_size != sizeof(int) ||
+        header.line_count < 0 || header.variable_count < 0 || header.code_count < 1 ||
+        header.constant_count < 0 || header.symbol_count < 0 || header.max_stack < 0 ||
+        header.function_count < 0) {
+        goto invalid;
+    }
+    compute_layout(&header, &layout);
+    if (layout.size > image.size || (header.pool_size > 0 && image.data[layout.pool + header.pool_size - 1] != '\0')) {
+        goto invalid;
+    }
+    if (!validate_code((const int *)(image.data + layout.code), (const int *)(image.data + layout.line_offsets), &header)) {
+        goto invalid;
+    }
+
+    char source_path[1024];
+    struct stat info;
+    if (image_source_path(image_path, source_path, sizeof(source_path)) && stat(source_path, &info) == 0 &&
+        ((int64_t)info.st_size != header.source_size || modified_ns(&info) != header.source_mtime_ns)) {
+        printf("Image %s is out of date\n", image_path);
+        unmap_file(&image);
+        return 0;
+    }
+
+    const char *pool = image.data + layout.pool;
+    const int32_t *line_numbers = (const int32_t *)(image.data + layout.line_numbers);
+    const int32_t *line_texts = (const int32_t *)(image.data + layout.line_texts);
+    const int32_t *variables = (const int32_t *)(image.data + layout.variables);
+    const int32_t *symbols = (const int32_t *)(image.data + layout.symbols);
+    const ImageConstant *constants = (const ImageConstant *)(image.data + layout.constants);
+
+    // recreating the variables in image order gives them their compiled slots
+    for (int i = 0; i < header.variable_count; i++) {
+        if ((uint32_t)variables[i] >= header.pool_size || pool[variables[i]] == '\0' ||
+            resolve_variable(interp, pool + variables[i]) != i) {
+            goto failed;
+        }
+    }
+
+    for (int i = 0; i < header.line_count; i++) {
+        if ((uint32_t)line_texts[i] >= header.pool_size) goto failed;
+        Line line = {line_numbers[i], (char *)(pool + line_texts[i]), NULL, 0, NULL, 0};
+        if (!append_line(interp, &line)) goto failed;
+    }
+
+    Bytecode *bc = calloc(1, sizeof(Bytecode));
+    if (!bc) goto failed;
+    bc->borrowed = 1;
+    bc->code = (int *)(image.data + layout.code);
+    bc->code_count = header.code_count;
+    bc->line_offsets = (int *)(image.data + layout.line_offsets);
+    bc->line_count = header.line_count;
+    bc->max_stack = header.max_stack;
+    bc->function_count = header.function_count;
+    bc->constants = malloc(sizeof(Value) * (header.constant_count + 1));
+    bc->symbols = malloc(sizeof(char *) * (header.symbol_count + 1));
+    if (!bc->constants || !bc->symbols) {
+        free_bytecode(bc);
+        goto failed;
+    }
+
+    for (int i = 0; i < header.symbol_count; i++) {
+        if ((uint32_t)symbols[i] >= header.pool_size) {
+            free_bytecode(bc);
+            goto failed;
+        }
+        bc->symbols[bc->symbol_count++] = pool + symbols[i];
+    }
+
+    for (int i = 0; i < header.constant_count; i++) {
+        const ImageConstant *constant = &constants[i];
+        if (constant->type == VALUE_STRING) {
+            if ((size_t)constant->string + constant->length >= header.pool_size) {
+                free_bytecode(bc);
+                goto failed;
+            }
+            // literals are immortal, like the ones the tokenizer puts in the program arena
+            String *string = arena_alloc(&interp->arena, sizeof(String) + constant->length + 1);
+            if (!string) {
+                free_bytecode(bc);
+                goto failed;
+            }
+            string->refcount = STRING_IMMORTAL;
+            string->length = constant->length;
+            string->capacity = constant->length;
+            memcpy(string->data, pool + constant->string, constant->length + 1);
+            bc->constants[i].type = VALUE_STRING;
+            bc->constants[i].data.string = string;
+        } else if (constant->type == VALUE_INTEGER) {
+            bc->constants[i] = create_integer_value(constant->integer);
+        } else {
+            bc->constants[i] = create_number_value(constant->number);
+        }
+        bc->constant_count++;
+    }
+
+    // statements are not part of the image, so it always runs on the VM
+    resolve_program(interp);
+    interp->bytecode = bc;
+    interp->image = image;
+    interp->use_vm = 1;
+    return 1;
+
+invalid:
+    printf("Error: %s is not a valid program image for this interpreter\n", image_path);
+    unmap_file(&image);
+    return 0;
+
+failed:
+    print_error(interp, "Cannot load program image");
+    cleanup_interpreter(interp);
+    unmap_file(&image);
+    return 0;
+}
+
+// falls back to the source next to the image when the image cannot be used
+int load_program_image(Interpreter *interp, const char *image_path) {
+    if (!interp || !image_path) return 0;
+
+    if (map_program_image(interp, image_path)) return 1;
+
+    char source_path[1024];
+    struct stat info;
+    if (!image_source_path(image_path, source_path, sizeof(source_path)) || stat(source_path, &info) != 0) {
+        return 0;
+    }
+    printf("Loading source %s instead\n", source_path);
+    strcpy(interp->error_message, "");
+    return load_program(interp, source_path);
+}
@@ -0,0 +1,440 @@
+#include "interpreter/basic_interpreter.h"
+
+static Value load_variable(Interpreter *interp, int slot) {
+    const Variable *var = &interp->variables[slot];
+    if (!var->defined) {
+        print_error(interp, "Undefined variable");
+        return create_number_value(0);
+    }
+    return retain_value(var->value);
+}
+
+// numeric operands skip the generic apply_operator() path
+static int fast_binary(Operator op, double l, double r, double *result) {
+    switch (op) {
+        case OP_PLUS:
+            *result = l + r;
+            return 1;
+        case OP_MINUS:
+            *result = l - r;
+            return 1;
+        case OP_MULTIPLY:
+            *result = l * r;
+            return 1;
+        case OP_LESS:
+            *result = (l < r) ? 1 : 0;
+            return 1;
+        case OP_LESS_EQUAL:
+            *result = (l <= r) ? 1 : 0;
+            return 1;
+        case OP_GREATER:
+            *result = (l > r) ? 1 : 0;
+            return 1;
+        case OP_GREATER_EQUAL:
+            *result = (l >= r) ? 1 : 0;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// DEF FN bindings of this run; BC_DEF binds interp->functions for the tree walker as well
+typedef struct vm_function_t {
+    int code; // offset of the body, -1 until its DEF runs
+    int param_count;
+} VmFunction;
+
+typedef struct vm_frame_t {
+    int return_pc;
+    int base; // stack index of the first argument
+} VmFrame;
+
+typedef struct vm_state_t {
+    Value *stack;
+    int capacity;
+    VmFunction *functions;
+    VmFrame frames[MAX_FUNCTION_DEPTH];
+} VmState;
+
+static int check_function(Interpreter *interp, const VmFunction *function) {
+    if (function->code < 0) {
+        print_error(interp, "Undefined function");
+        return 0;
+    }
+    return 1;
+}
+
+static int run(Interpreter *interp, const Bytecode *bc, VmState *state) {
+    const int *code = bc->code;
+    Value *stack = state->stack;
+    int sp = 0;
+    int pc = 0;
+    int depth = 0; // DEF FN calls in progress
+    int frame_base = 0;
+
+    while (interp->running) {
+        switch (code[pc++]) {
+            case BC_LINE:
+                interp->current_line = code[pc++];
+                if (interp->profile) profile_line(interp, interp->current_line);
+                break;
+            case BC_CONST:
+                stack[sp++] = retain_value(bc->constants[code[pc++]]);
+                break;
+            case BC_LOAD_VAR:
+                stack[sp++] = load_variable(interp, code[pc++]);
+                if (strlen(interp->error_message) > 0) goto fail;
+                break;
+            case BC_STORE_VAR:
+                if (!set_variable_slot(interp, code[pc++], stack[--sp])) goto fail;
+                break;
+            case BC_APPEND_VAR: {
+                const int slot = code[pc++];
+                const int count = code[pc++];
+                sp -= count;
+                if (!append_to_variable(interp, slot, &stack[sp], count)) goto fail;
+                break;
+            }
+            case BC_UNARY: {
+                const Operator op = (Operator)code[pc++];
+                stack[sp - 1] = apply_unary(interp, op, stack[sp - 1]);
+                if (strlen(interp->error_message) > 0) goto fail;
+                break;
+            }
+            case BC_BINARY: {
+                const Operator op = (Operator)code[pc++];
+                Value *left = &stack[sp - 2];
+                Value *right = &stack[sp - 1];
+                sp--;
+                if (left->type == VALUE_NUMBER && right->type == VALUE_NUMBER &&
+                    fast_binary(op, left->data.number, right->data.number, &left->data.number)) {
+                    break;
+                }
+                if (left->type == VALUE_INTEGER && right->type == VALUE_INTEGER) {
+                    *left = apply_integer_operator(interp, left->data.integer, op, right->data.integer);
+                    if (strlen(interp->error_message) > 0) goto fail;
+                    break;
+                }
+                *left = apply_operator(interp, *left, op, *right);
+                if (strlen(interp->error_message) > 0) goto fail;
+                break;
+            }
+            case BC_LOAD_ELEMENT: {
+                const int slot = code[pc++];
+                const int count = code[pc++];
+                sp -= count;
+                stack[sp] = load_element(interp, slot, &stack[sp], count);
+                sp++;
+                if (strlen(interp->error_message) > 0) goto fail;
+                break;
+            }
+            case BC_STORE_ELEMENT: {
+                const int slot = code[pc++];
+                const int count = code[pc++];
+                sp -= count + 1;
+                if (!store_element(interp, slot, &stack[sp], count, stack[sp + count])) goto fail;
+                break;
+            }
+            case BC_DIM: {
+                const int slot = code[pc++];
+                const int count = code[pc++];
+                sp -= count;
+                if (!dimension_array(interp, slot, &stack[sp], count)) goto fail;
+                break;
+            }
+            case BC_MAT: {
+                const MatOp op = (MatOp)code[pc++];
+                const int target = code[pc++];
+                const int left = code[pc++];
+                const int right = code[pc++];
+                const int count = code[pc++];
+                sp -= count;
+                if (!assign_matrix(interp, op, target, left, right, &stack[sp], count)) goto fail;
+                break;
+            }
+            case BC_READ: {
+                const int slot = code[pc++];
+                Value value;
+                if (!read_data(interp, &value) || !set_variable_slot(interp, slot, value)) goto fail;
+                break;
+            }
+            case BC_READ_ELEMENT: {
+                const int slot = code[pc++];
+                const int count = code[pc++];
+                sp -= count;
+                Value value;
+                if (!read_data(interp, &value)) {
+                    for (int i = 0; i < count; i++) cleanup_value(&stack[sp + i]);
+                    goto fail;
+                }
+                if (!store_element(interp, slot, &stack[sp], count, value)) goto fail;
+                break;
+            }
+            case BC_RESTORE:
+                restore_data(interp, code[pc++]);
+                break;
+            case BC_DEF: {
+                const int slot = code[pc++];
+                VmFunction *function = &state->functions[slot];
+                function->code = code[pc++];
+                function->param_count = code[pc++];
+                // immediate statements after the run call it through the tree walker
+                if (bc->definitions) interp->functions[slot].definition = bc->definitions[code[pc]];
+                pc++;
+                break;
+            }
+            case BC_CHECK_FN:
+                if (!check_function(interp, &state->functions[code[pc++]])) goto fail;
+                break;
+            case BC_CALL_FN: {
+                const VmFunction *function = &state->functions[code[pc++]];
+                const int count = code[pc++];
+                if (!check_function(interp, function)) goto fail;
+                if (count != function->param_count) {
+                    print_error(interp, "Wrong number of function arguments");
+                    goto fail;
+                }
+                if (depth >= MAX_FUNCTION_DEPTH) {
+                    print_error(interp, "Function calls nested too deeply");
+                    goto fail;
+                }
+                // a body needs at most max_stack slots above its arguments
+                if (sp + bc->max_stack + 1 > state->capacity) {
+                    Value *grown = realloc(stack, sizeof(Value) * (size_t)state->capacity * 2);
+                    if (!grown) {
+                        print_error(interp, "Memory allocation failed");
+                        goto fail;
+                    }
+                    stack = state->stack = grown;
+                    state->capacity *= 2;
+                }
+                state->frames[depth].return_pc = pc;
+                state->frames[depth].base = frame_base;
+                depth++;
+                frame_base = sp - count;
+                pc = function->code;
+                break;
+            }
+            case BC_RETURN_FN: {
+                const Value result = stack[--sp];
+                while (sp > frame_base) cleanup_value(&stack[--sp]);
+                stack[sp++] = result;
+                depth--;
+                pc = state->frames[depth].return_pc;
+                frame_base = state->frames[depth].base;
+                break;
+            }
+            case BC_LOAD_PARAM:
+                stack[sp] = retain_value(stack[frame_base + code[pc++]]);
+                sp++;
+                break;
+            case BC_PICK: {
+                const int offset = code[pc++];
+                stack[sp] = retain_value(stack[sp - offset]);
+                sp++;
+                break;
+            }
+            case BC_DROP_UNDER: {
+                // an inlined call leaves its result above its arguments
+                const int count = code[pc++];
+                const Value result = stack[sp - 1];
+                for (int i = sp - 1 - count; i < sp - 1; i++) cleanup_value(&stack[i]);
+                sp -= count;
+                stack[sp - 1] = result;
+                break;
+            }
+            case BC_COERCE: {
+                const int offset = code[pc++];
+                if (!coerce_value(interp, code[pc++], &stack[sp - offset])) goto fail;
+                break;
+            }
+            case BC_CALL: {
+                const Function func = (Function)code[pc++];
+                const int arg_count = code[pc++];
+                sp -= arg_count;
+                stack[sp] = apply_function(interp, func, &stack[sp], arg_count);
+                sp++;
+                if (strlen(interp->error_message) > 0) goto fail;
+                break;
+            }
+            case BC_PRINT: {
+                Value *value = &stack[--sp];
+                write_value(interp, value);
+                cleanup_value(value);
+                break;
+            }
+            case BC_PRINT_TAB:
+                write_output(interp, "\t", 1);
+                break;
+            case BC_INPUT: {
+                const int slot = code[pc++];
+                const int prompt = code[pc++];
+                const int field = code[pc++];
+                const int count = code[pc++];
+                Value value;
+                if (!read_input_value(interp, prompt >= 0 && field == 0 ? bc->symbols[prompt] : NULL, field, count, &value)) {
+                    // the end of input leaves the variable as it was
+                    if (strlen(interp->error_message) > 0) goto fail;
+                    break;
+                }
+                if (!set_variable_slot(interp, slot, value)) goto fail;
+                break;
+            }
+            case BC_INPUT_ELEMENT: {
+                const int slot = code[pc++];
+                const int prompt = code[pc++];
+                const int field = code[pc++];
+                const int count = code[pc++];
+                const int subscripts = code[pc++];
+                sp -= subscripts;
+                Value value;
+                if (!read_input_value(interp, prompt >= 0 && field == 0 ? bc->symbols[prompt] : NULL, field, count, &value)) {
+                    for (int i = 0; i < subscripts; i++) cleanup_value(&stack[sp + i]);
+                    if (strlen(interp->error_message) > 0) goto fail;
+                    break;
+                }
+                if (!store_element(interp, slot, &stack[sp], subscripts, value)) goto fail;
+                break;
+            }
+            case BC_JUMP_IF_FALSE: {
+                const int target = code[pc++];
+                Value *condition = &stack[--sp];
+                const int is_true = condition->type != VALUE_STRING && to_number(*condition) != 0;
+                cleanup_value(condition);
+                if (!is_true) pc = target;
+                break;
+            }
+            case BC_GOTO:
+                pc = bc->line_offsets[code[pc]];
+                break;
+            case BC_GOSUB:
+                // push return address (next line after current)
+                if (!push_gosub(interp, interp->current_line + 1, code[pc])) goto fail;
+                pc = bc->line_offsets[code[pc]];
+                break;
+            case BC_ON_GOTO:
+            case BC_ON_GOSUB: {
+                // the table of line indices follows the count
+                const int gosub = code[pc - 1] == BC_ON_GOSUB;
+                const int count = code[pc++];
+                int choice;
+                if (!select_jump(interp, stack[--sp], count, &choice)) goto fail;
+                if (choice == -1) {
+                    pc += count;
+                    break;
+                }
+                const int line_index = code[pc + choice];
+                if (line_index == -1) {
+                    print_error(interp, "Line number not found");
+                    goto fail;
+                }
+                if (gosub && !push_gosub(interp, interp->current_line + 1, line_index)) goto fail;
+                pc = bc->line_offsets[line_index];
+                break;
+            }
+            case BC_RETURN: {
+                int return_line;
+                if (!pop_gosub(interp, &return_line)) goto fail;
+                pc = bc->line_offsets[return_line];
+                break;
+            }
+            case BC_FOR: {
+                const int slot = code[pc++];
+                sp -= 3;
+                if (!begin_for_loop(interp, slot, stack[sp], stack[sp + 1], stack[sp + 2])) goto fail;
+                break;
+            }
+            case BC_NEXT: {
+                // counting loops step here, everything else goes through step_for_loop()
+                ForLoop *loop = interp->for_stack_top >= 0 ? &interp->for_stack[interp->for_stack_top] : NULL;
+                Variable *var = loop && loop->integral ? &interp->variables[loop->slot] : NULL;
+                if (var && var->integer && var->value.data.integer == loop->counter) {
+                    loop->counter += loop->increment;
+                    var->value.data.integer = loop->counter;
+                } else if (var && !var->integer && var->value.type == VALUE_NUMBER &&
+                           var->value.data.number == (double)loop->counter) {
+                    loop->counter += loop->increment;
+                    var->value.data.number = (double)loop->counter;
+                } else {
+                    var = NULL;
+                }
+                if (var) {
+                    if (loop->increment > 0 ? loop->counter <= loop->limit : loop->counter >= loop->limit) {
+                        pc = bc->line_offsets[loop->body_line];
+                    } else {
+                        interp->for_stack_top--;
+                    }
+                    break;
+                }
+
+                int continue_loop;
+                if (!step_for_loop(interp, &continue_loop)) goto fail;
+                if (continue_loop) {
+                    pc = bc->line_offsets[interp->for_stack[interp->for_stack_top].body_line];
+                }
+                break;
+            }
+            case BC_END:
+                interp->running = 0;
+                break;
+            case BC_ERROR:
+                print_error(interp, bc->symbols[code[pc++]]);
+                goto fail;
+            default:
+                print_error(interp, "Invalid bytecode");
+                goto fail;
+        }
+    }
+
+    return 1;
+
+fail:
+    while (sp > 0) {
+        cleanup_value(&stack[--sp]);
+    }
+    return 0;
+}
+
+int execute_bytecode(Interpreter *interp) {
+    if (!interp) {
+        return 0;
+    }
+
+    if (!interp->bytecode) {
+        interp->bytecode = compile_program(interp);
+        if (!interp->bytecode) {
+            print_error(interp, "Bytecode compilation failed");
+            return 0;
+        }
+    }
+
+    const Bytecode *bc = interp->bytecode;
+    VmState *state = malloc(sizeof(VmState));
+    if (!state) {
+        print_error(interp, "Memory allocation failed");
+        return 0;
+    }
+    state->capacity = bc->max_stack + 1;
+    state->stack = malloc(sizeof(Value) * (size_t)state->capacity);
+    state->functions = malloc(sizeof(VmFunction) * ((size_t)bc->function_count + 1));
+    if (!state->stack || !state->functions) {
+        free(state->stack);
+        free(state->functions);
+        free(state);
+        print_error(interp, "Memory allocation failed");
+        return 0;
+    }
+    for (int i = 0; i < bc->function_count; i++) {
+        state->functions[i].code = -1;
+        state->functions[i].param_count = 0;
+    }
+
+    interp->running = 1;
+    interp->current_line = 0;
+    const int ok = run(interp, bc, state);
+
+    free(state->stack);
+    free(state->functions);
+    free(state);
+    return ok;
+}
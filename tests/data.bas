@@ -0,0 +1,26 @@
+10 REM DATA is collected at load time, wherever it sits in the program
+20 READ A, B$, C
+30 PRINT A; " "; B$; " "; C; "\n"
+40 DIM X(2)
+50 FOR I = 0 TO 2
+60 READ X(I)
+70 NEXT I
+80 PRINT X(0) + X(1) + X(2); "\n"
+90 READ S$, T$, N%
+100 PRINT S$; "|"; T$; "|"; N%; "\n"
+110 RESTORE 210
+120 READ D
+130 RESTORE
+140 READ E
+150 PRINT D; " "; E; "\n"
+160 REM RESTORE to a line without DATA starts at the next DATA after it
+170 RESTORE 150
+180 READ F
+185 PRINT F; "\n"
+190 RESTORE 210
+192 READ G$, H$, K
+194 PRINT G$; " "; H$; " "; K; "\n"
+196 READ L
+200 DATA 1.5, "a, quoted string", -2
+205 DATA 10, 20, 30
+210 DATA "x y", unquoted text, 7
@@ -0,0 +1,14 @@
+10 REM a DEF binds when it runs, and a later DEF of the same name replaces it
+20 FOR I = 1 TO 3
+30 IF I = 2 THEN DEF FNA(X) = X + 100
+40 IF I <> 2 THEN DEF FNA(X) = X * 10
+50 PRINT FNA(I); " ";
+60 NEXT I
+70 DEF FNB%(X, Y) = X / Y
+80 DEF FNC$(S$, N) = S$ + STR$(N)
+90 PRINT FNB%(7, 2); " "; FNC$("n=", FNA(1)); "\n"
+100 X = 5
+110 DEF FND(X) = X + FNA(X)
+120 PRINT FND(2); " "; X; "\n"
+130 PRINT FNE(1)
+140 DEF FNE(X) = 0
@@ -0,0 +1,5 @@
+10 REM DEF FN names and parameters ignore case like variables; FNB must not read the global Y
+20 Y = 1
+30 DEF FNB(y) = Y + 100
+40 DEF fnA(X) = x * 2
+50 PRINT FNB(5); " "; fnb(6); " "; FNA(3); " "; fna(4); "\n"
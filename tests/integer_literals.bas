@@ -0,0 +1,8 @@
+10 REM a whole literal beside A% computes like a number variable would: no integer overflow in + - *
+20 A% = 4611686018427387904
+30 B = 2
+40 PRINT A% * 2; " "; A% * B; "\n"
+50 I% = 123456789
+60 PRINT I% + 1; " "; I% * 2; " "; I% - 1 = I% - B / 2; "\n"
+70 REM comparisons, MOD and \ cannot overflow, so they keep integer arithmetic
+80 PRINT I% MOD 10; " "; I% \ 2; " "; I% > 5; " "; I% = 123456789; "\n"
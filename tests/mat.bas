@@ -0,0 +1,31 @@
+10 REM MAT on whole arrays, subscript 0 included; targets take the shape of the result
+20 DIM A(1, 2), B(1, 2)
+30 FOR I = 0 TO 1
+40 FOR J = 0 TO 2
+50 A(I, J) = I * 3 + J
+60 B(I, J) = 10
+70 NEXT J
+80 NEXT I
+90 MAT C = A + B
+100 MAT D = A - B
+110 PRINT C(0, 0); " "; C(1, 2); " "; D(0, 1); " "; D(1, 2); "\n"
+120 MAT T = TRN(A)
+130 PRINT T(2, 0); " "; T(0, 1); " "; T(2, 1); "\n"
+140 MAT P = A * T
+150 PRINT P(0, 0); " "; P(0, 1); " "; P(1, 0); " "; P(1, 1); "\n"
+160 MAT S = (0.5) * A
+170 PRINT S(1, 1); " "; S(1, 2); "\n"
+180 MAT I = IDN(1, 1)
+190 MAT Q = P * I
+200 MAT R = Q
+210 PRINT R(0, 0); " "; R(1, 1); " "; I(0, 0); " "; I(0, 1); "\n"
+220 MAT E = CON(1, 1)
+230 MAT F = ZER(2, 1)
+240 MAT E = E + E
+250 PRINT E(1, 1); " ";
+255 MAT E = ZER
+258 PRINT E(1, 1); " "; F(2, 1); "\n"
+260 MAT S = (A(1, 1) + 1) * S
+270 PRINT S(1, 2); "\n"
+280 REM shapes that do not fit stop the program
+300 MAT C = A * B
@@ -0,0 +1,27 @@
+10 REM ON n picks the nth target and falls through when n is outside the list
+20 FOR N = 0 TO 4
+30 ON N GOSUB 300, 310, 320
+40 NEXT N
+50 PRINT "\n"
+60 K = 1
+70 ON K + 1 GOTO 900, 100, 900
+80 PRINT "fell through\n"
+90 END
+100 PRINT "two "
+110 ON 1.6 GOTO 900, 130
+120 PRINT "wrong\n"
+130 PRINT "rounded "
+140 ON -1 GOTO 900
+150 ON 4 GOSUB 900, 900, 900
+160 PRINT "outside\n"
+170 REM a missing target is only an error when it is taken
+180 ON 1 GOTO 200, 999
+190 PRINT "wrong\n"
+200 ON 2 GOTO 80, 999
+300 PRINT "a";
+305 RETURN
+310 PRINT "b";
+315 RETURN
+320 PRINT "c";
+325 RETURN
+900 PRINT "wrong\n"
@@ -0,0 +1,27 @@
+# runs one program from tests/ and fails unless everything it prints matches
+# the .expected file next to it; a .repl file is typed at the prompt instead
+#
+#   cmake -DBASIC=<basic> [-DENGINE=--vm] -DPROGRAM=<tests/name.bas|.repl> -P run_test.cmake
+
+get_filename_component(directory ${PROGRAM} DIRECTORY)
+get_filename_component(file ${PROGRAM} NAME)
+get_filename_component(name ${PROGRAM} NAME_WE)
+
+# run from tests/ so the program's path prints the same everywhere
+if (PROGRAM MATCHES "\\.repl$")
+    execute_process(COMMAND ${BASIC} ${ENGINE}
+            INPUT_FILE ${PROGRAM}
+            WORKING_DIRECTORY ${directory}
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE output)
+else ()
+    execute_process(COMMAND ${BASIC} ${ENGINE} ${file}
+            WORKING_DIRECTORY ${directory}
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE output)
+endif ()
+
+file(READ ${directory}/${name}.expected expected)
+if (NOT output STREQUAL expected)
+    message(FATAL_ERROR "${file} ${ENGINE} printed\n${output}\ninstead of\n${expected}")
+endif ()